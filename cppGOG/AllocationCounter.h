@@ -0,0 +1,46 @@
+/*
+* Counts the heap allocations made by each thread, in debug builds only
+* Used to check that the tracking loop works on memory reserved beforehand
+*/
+#pragma once
+
+#ifdef _DEBUG
+#include <cstdlib>
+#include <new>
+
+/// Amount of calls to operator new made by this thread
+thread_local long long allocationCount = 0;
+
+void* operator new(std::size_t size)
+{
+	allocationCount++;
+	void* p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+#endif // _DEBUG
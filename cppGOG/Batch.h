@@ -0,0 +1,129 @@
+/*
+* Tracking of many sequences in a single process
+* A manifest lists one job per line: "sequence,detection_file,output_folder" and
+* optionally the detector type ("DETRAC" or "YOLO"). Jobs run at the same time on
+* the thread pool, the biggest detection files first so the longest sequences
+* don't end up running alone at the end
+*/
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "dirent.h"
+
+#include "BinaryDetections.h"
+#include "CSV.h"
+#include "GOG.h"
+#include "ThreadPool.h"
+#include "UA-DETRAC.h"
+#include "YOLO.h"
+
+namespace Batch
+{
+	/// One sequence to track, and how it went
+	struct Job
+	{
+		std::string sequence;
+		std::string detections_file;
+		std::string output_folder;
+		std::string detections_type = "DETRAC";
+		// Bytes of the detection file, to schedule the longest sequences first
+		long long size = 0;
+		bool done = false;
+		int frames = 0;
+		int boxes = 0;
+		double seconds = 0;
+	};
+
+	/// Read the jobs of a manifest. Lines with less than 3 columns are skipped
+	void read_manifest(std::ifstream& file, std::vector<Job>& jobs)
+	{
+		for (CSVIterator loop(file); loop != CSVIterator(); ++loop)
+		{
+			if ((*loop).size() < 3) continue;
+			Job job;
+			job.sequence = (*loop)[0];
+			job.detections_file = (*loop)[1];
+			job.output_folder = (*loop)[2];
+			if ((*loop).size() > 3 && !(*loop)[3].empty())
+				job.detections_type = (*loop)[3];
+			jobs.push_back(job);
+		}
+	}
+
+	/// Load, track and write the results of a single job
+	void run_job(Job& job, bool nms, const GOGSettings& settings)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		Detections dres;
+		bool loaded;
+		if (BinaryDetections::recognize(job.detections_file))
+			loaded = BinaryDetections::read_detections(job.detections_file, dres);
+		else if (job.detections_type == "YOLO")
+			loaded = YOLO::read_detections(job.detections_file, dres);
+		else
+			loaded = UADETRAC::read_detections(job.detections_file, dres);
+		if (!loaded || dres.frame.empty()) return;
+
+		TrackingGraph graph(std::move(dres));
+		DPTracking gog(nms, graph, settings);
+		gog.startTracking();
+		std::vector< std::vector<BoundingBox> > bboxes = gog.getBBoxes();
+		if (!bboxes.empty())
+			UADETRAC::write_results(job.output_folder, job.sequence, bboxes, true);
+
+		job.frames = graph.getDres().frame.back();
+		job.boxes = gog.getIndices().size();
+		job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		job.done = true;
+	}
+
+	/// Run all the jobs of the manifest on the pool, then print the frames per
+	/// second of every sequence and of the whole batch
+	void run(std::vector<Job>& jobs, ThreadPool& pool, bool nms, const GOGSettings& settings)
+	{
+		// Output folders are created before, as jobs may share them
+		for (int i = 0; i < jobs.size(); i++)
+		{
+			DIR * dir = opendir(jobs[i].output_folder.c_str());
+			if (dir != NULL)
+				closedir(dir);
+			else if (system(("mkdir " + jobs[i].output_folder).c_str()))
+				std::cout << "\tERROR -> Failed to create directory " << jobs[i].output_folder << std::endl;
+
+			std::ifstream file(jobs[i].detections_file, std::ios::binary | std::ios::ate);
+			jobs[i].size = file ? (long long)file.tellg() : 0;
+		}
+
+		// The pool hands out the jobs in order
+		std::vector<int> order(jobs.size());
+		for (int i = 0; i < order.size(); i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&jobs](int a, int b) { return jobs[a].size > jobs[b].size; });
+
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		pool.parallelFor(order.size(), [&](int i) { run_job(jobs[order[i]], nms, settings); });
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+		long long frames = 0;
+		for (int i = 0; i < jobs.size(); i++)
+		{
+			const Job& job = jobs[i];
+			if (!job.done)
+			{
+				std::cout << "ERROR -> " << job.sequence << " : detection file " << job.detections_file
+					<< " not found or empty" << std::endl;
+				continue;
+			}
+			frames += job.frames;
+			std::cout << job.sequence << " : " << job.frames << " frames, " << job.boxes << " boxes, "
+				<< job.seconds << " seconds, " << (job.seconds > 0 ? job.frames / job.seconds : 0) << " fps" << std::endl;
+		}
+		std::cout << "Batch : " << jobs.size() << " sequences, " << frames << " frames, " << seconds
+			<< " seconds, " << (seconds > 0 ? frames / seconds : 0) << " fps" << std::endl;
+	}
+
+} // end of namespace
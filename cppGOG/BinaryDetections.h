@@ -0,0 +1,150 @@
+/*
+* Detections in a binary file, the same columns as the Detections struct
+* A header, then every column as an array aligned to 64 bytes: x, y, w, h and
+* score as floats, frame and the frame offsets table as 32 bit ints. Loading
+* is mapping the file and copying the arrays, nothing is parsed. Files are
+* written in the byte order of the machine, and only read on one with the same
+*/
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <string>
+
+#include "GOG.h"
+#include "MappedFile.h"
+
+namespace BinaryDetections
+{
+	const char magic[8] = { 'G', 'O', 'G', 'D', 'E', 'T', 'S', '\0' };
+	const uint32_t version = 1;
+	const uint32_t byteOrder = 0x01020304;
+	const uint64_t alignment = 64;
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		// Detections, and entries of the frame offsets table
+		uint64_t count;
+		uint64_t offsets;
+		int32_t firstFrame;
+		uint32_t reserved;
+		// Where every column starts in the file
+		uint64_t x, y, w, h, score, frame, frameOffsets;
+	};
+
+	/// True if "filename" starts like a binary detections file
+	bool recognize(const std::string& filename)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		char start[sizeof(magic)];
+		if (!file.read(start, sizeof(start))) return false;
+		return memcmp(start, magic, sizeof(magic)) == 0;
+	}
+
+	/// Write the columns of "detections", with the frames indexed
+	bool write_detections(const std::string& filename, const Detections& detections)
+	{
+		Detections indexed;
+		const Detections* source = &detections;
+		if (!detections.framesIndexed())
+		{
+			indexed = detections;
+			indexed.indexFrames();
+			source = &indexed;
+		}
+
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, magic, sizeof(magic));
+		header.version = version;
+		header.byteOrder = byteOrder;
+		header.count = source->x.size();
+		header.offsets = source->frameOffsets.size();
+		header.firstFrame = source->firstFrame;
+		// Every column after the one before, aligned
+		uint64_t position = sizeof(Header);
+		uint64_t* columns[] = { &header.x, &header.y, &header.w, &header.h, &header.score, &header.frame, &header.frameOffsets };
+		for (int c = 0; c < 7; c++)
+		{
+			position = (position + alignment - 1) / alignment * alignment;
+			*columns[c] = position;
+			position += (c == 6 ? header.offsets : header.count) * 4;
+		}
+
+		std::ofstream file(filename, std::ios::binary);
+		if (!file) return false;
+		file.write((const char*)&header, sizeof(header));
+		const void* data[] = { source->x.data(), source->y.data(), source->w.data(), source->h.data(),
+			source->score.data(), source->frame.data(), source->frameOffsets.data() };
+		const char padding[alignment] = { 0 };
+		position = sizeof(Header);
+		for (int c = 0; c < 7; c++)
+		{
+			file.write(padding, *columns[c] - position);
+			uint64_t bytes = (c == 6 ? header.offsets : header.count) * 4;
+			file.write((const char*)data[c], bytes);
+			position = *columns[c] + bytes;
+		}
+		return (bool)file;
+	}
+
+	/// Read a file of write_detections. False if it can't be read or isn't a valid one
+	bool read_detections(const std::string& filename, Detections& detections)
+	{
+		MappedFile file;
+		if (!file.open(filename) || file.size() < sizeof(Header)) return false;
+		const char* base = (const char*)file.data();
+		Header header;
+		memcpy(&header, base, sizeof(header));
+		if (memcmp(header.magic, magic, sizeof(magic)) != 0) return false;
+		if (header.version != version || header.byteOrder != byteOrder)
+		{
+			std::cout << "ERROR -> " << filename << " is version " << header.version
+				<< " or has another byte order, it can't be read" << std::endl;
+			return false;
+		}
+		uint64_t columns[] = { header.x, header.y, header.w, header.h, header.score, header.frame, header.frameOffsets };
+		for (int c = 0; c < 7; c++)
+		{
+			// Compared before multiplying, a corrupt count could overflow
+			uint64_t entries = c == 6 ? header.offsets : header.count;
+			if (columns[c] > file.size() || entries > (file.size() - columns[c]) / 4)
+			{
+				std::cout << "ERROR -> " << filename << " is truncated" << std::endl;
+				return false;
+			}
+		}
+
+		const float* x = (const float*)(base + header.x);
+		const float* y = (const float*)(base + header.y);
+		const float* w = (const float*)(base + header.w);
+		const float* h = (const float*)(base + header.h);
+		const float* score = (const float*)(base + header.score);
+		const int* frame = (const int*)(base + header.frame);
+		const int* offsets = (const int*)(base + header.frameOffsets);
+		// Detections are found through the table, it can't point out of them
+		for (uint64_t i = 0; i < header.offsets; i++)
+			if (offsets[i] < (i == 0 ? 0 : offsets[i - 1]) || (uint64_t)offsets[i] > header.count)
+			{
+				std::cout << "ERROR -> " << filename << " has an invalid frame offsets table" << std::endl;
+				return false;
+			}
+		detections.x.assign(x, x + header.count);
+		detections.y.assign(y, y + header.count);
+		detections.w.assign(w, w + header.count);
+		detections.h.assign(h, h + header.count);
+		detections.score.assign(score, score + header.count);
+		detections.frame.assign(frame, frame + header.count);
+		detections.frameOffsets.assign(offsets, offsets + header.offsets);
+		detections.firstFrame = header.firstFrame;
+		// A table that doesn't match the frames is built again
+		if (!detections.framesIndexed())
+			detections.indexFrames();
+		return true;
+	}
+
+} // end of namespace
@@ -0,0 +1,214 @@
+/*
+* DP tracking of long sequences in overlapping chunks of frames
+* Every chunk gets its own graph and DP, run in parallel on the thread pool, so
+* only the chunks being tracked are in memory. Tracks of consecutive chunks that
+* share detections in the overlap are joined, and each chunk gives the boxes of
+* the frames up to the middle of its overlaps
+*/
+#pragma once
+#include <vector>
+#include <algorithm>
+
+#include "GOG.h"
+#include "ThreadPool.h"
+#include "UnionFind.h"
+
+class ChunkedTracking
+{
+public:
+	ChunkedTracking(bool nmsOn, const Detections& detections, int chunkFrames, int overlapFrames,
+		ThreadPool* pool = NULL, const GOGSettings& settings = GOGSettings());
+
+	void startTracking();
+	std::vector< std::vector<BoundingBox> > getBBoxes();
+	/// Detections kept after tracking
+	const std::vector<int>& getIndices() const { return indices; };
+	/// Track of every kept detection
+	const std::vector<int>& getIds() const { return ids; };
+	int getChunkCount() const { return chunks.size(); };
+
+private:
+	void trackChunk(int k);
+	void stitch(int k, UnionFind& identities);
+
+	/// Frames of a chunk, and its result
+	struct Chunk
+	{
+		int firstFrame, lastFrame;
+		// Detections of the chunk, [begin, end) of the whole sequence
+		int begin, end;
+		// Track of every detection of the chunk, from 1. 0 if not kept
+		std::vector<int> track;
+		int tracks;
+	};
+
+	bool nmsInLoop;
+	// Not owned, must outlive the tracker, except when its frames had to be indexed
+	const Detections* dres;
+	Detections owned;
+	int chunkFrames;
+	int overlapFrames;
+	ThreadPool* pool;
+	GOGSettings settings;
+
+	std::vector<Chunk> chunks;
+	std::vector<int> indices;
+	std::vector<int> ids;
+};
+
+/******************************************************************************
+* CHUNKED TRACKING IMPLEMENTATION
+******************************************************************************/
+/// Chunks of "chunkFrames" frames, each one starting "overlapFrames" frames before the last ends
+ChunkedTracking::ChunkedTracking(bool nmsOn, const Detections& detections, int chunkFrames, int overlapFrames,
+	ThreadPool* pool, const GOGSettings& settings)
+	: nmsInLoop(nmsOn), dres(&detections), chunkFrames(MAX(chunkFrames, 2)),
+	overlapFrames(overlapFrames), pool(pool), settings(settings)
+{
+	if (this->overlapFrames > this->chunkFrames - 1) this->overlapFrames = this->chunkFrames - 1;
+	if (this->overlapFrames < 0) this->overlapFrames = 0;
+	if (!detections.framesIndexed())
+	{
+		owned = detections;
+		owned.indexFrames();
+		dres = &owned;
+	}
+}
+
+void ChunkedTracking::startTracking()
+{
+	chunks.clear();
+	indices.clear();
+	ids.clear();
+	if (dres->frame.empty()) return;
+
+	int first = dres->frame.front(), last = dres->frame.back();
+	int step = chunkFrames - overlapFrames;
+	for (int start = first; ; start += step)
+	{
+		Chunk chunk;
+		chunk.firstFrame = start;
+		chunk.lastFrame = MIN(start + chunkFrames - 1, last);
+		chunk.begin = dres->frameBegin(chunk.firstFrame);
+		chunk.end = dres->frameEnd(chunk.lastFrame);
+		chunk.tracks = 0;
+		chunks.push_back(chunk);
+		if (chunk.lastFrame >= last) break;
+	}
+
+	if (pool != NULL)
+		pool->parallelFor(chunks.size(), [this](int k) { trackChunk(k); });
+	else
+		for (int k = 0; k < chunks.size(); k++) trackChunk(k);
+
+	// Every track of every chunk is an identity, until joined with the one it continues
+	std::vector<int> firstIdentity(chunks.size() + 1, 0);
+	for (int k = 0; k < chunks.size(); k++)
+		firstIdentity[k + 1] = firstIdentity[k] + chunks[k].tracks;
+	UnionFind identities(firstIdentity.back());
+	for (int k = 0; k + 1 < chunks.size(); k++)
+		stitch(k, identities);
+
+	// Chunk "k" gives the frames before the middle of its overlap with the next one.
+	// Ids are numbered in order of appearance
+	std::vector<int> idOf(firstIdentity.back(), 0);
+	std::vector< std::vector<int> > byId;
+	for (int k = 0; k < chunks.size(); k++)
+	{
+		const Chunk& chunk = chunks[k];
+		int from = k == 0 ? chunk.begin : dres->frameBegin(chunk.firstFrame + overlapFrames / 2);
+		int to = k + 1 == chunks.size() ? chunk.end : dres->frameBegin(chunks[k + 1].firstFrame + overlapFrames / 2);
+		for (int i = from; i < to; i++)
+		{
+			int t = chunk.track[i - chunk.begin];
+			if (t == 0) continue;
+			int identity = identities.find(firstIdentity[k] + t - 1);
+			if (idOf[identity] == 0)
+			{
+				byId.push_back(std::vector<int>());
+				idOf[identity] = byId.size();
+			}
+			byId[idOf[identity] - 1].push_back(i);
+		}
+	}
+	for (int id = 0; id < byId.size(); id++)
+	{
+		indices.insert(indices.end(), byId[id].begin(), byId[id].end());
+		ids.insert(ids.end(), byId[id].size(), id + 1);
+	}
+}
+
+/// Build the graph of one chunk and track it. Only the track of every detection is kept
+void ChunkedTracking::trackChunk(int k)
+{
+	Chunk& chunk = chunks[k];
+	Detections part;
+	part.x.assign(dres->x.begin() + chunk.begin, dres->x.begin() + chunk.end);
+	part.y.assign(dres->y.begin() + chunk.begin, dres->y.begin() + chunk.end);
+	part.w.assign(dres->w.begin() + chunk.begin, dres->w.begin() + chunk.end);
+	part.h.assign(dres->h.begin() + chunk.begin, dres->h.begin() + chunk.end);
+	part.score.assign(dres->score.begin() + chunk.begin, dres->score.begin() + chunk.end);
+	part.frame.assign(dres->frame.begin() + chunk.begin, dres->frame.begin() + chunk.end);
+	part.indexFrames();
+
+	TrackingGraph graph(std::move(part));
+	DPTracking gog(nmsInLoop, graph, settings);
+	// Only the real detection 0 keeps the special meaning it has in the whole sequence
+	if (chunk.begin != 0) gog.setNoLink(-1);
+	gog.startTracking();
+
+	const std::vector<int>& kept = gog.getIndices();
+	const std::vector<int>& trackIds = gog.getIds();
+	chunk.track.assign(chunk.end - chunk.begin, 0);
+	for (int i = 0; i < kept.size(); i++)
+	{
+		chunk.track[kept[i]] = trackIds[i];
+		chunk.tracks = MAX(chunk.tracks, trackIds[i]);
+	}
+}
+
+/// Join the tracks of chunks "k" and "k + 1" that share detections in their overlap.
+/// Each track is joined to at most one, the pairs sharing more detections first
+void ChunkedTracking::stitch(int k, UnionFind& identities)
+{
+	const Chunk& a = chunks[k];
+	const Chunk& b = chunks[k + 1];
+	std::vector< std::pair<int, int> > shared;
+	for (int i = b.begin; i < a.end; i++)
+	{
+		int ta = a.track[i - a.begin], tb = b.track[i - b.begin];
+		if (ta != 0 && tb != 0) shared.push_back(std::make_pair(ta, tb));
+	}
+	std::sort(shared.begin(), shared.end());
+
+	// (detections shared, track in "a", track in "b")
+	std::vector< std::pair<int, std::pair<int, int> > > pairs;
+	for (int s = 0; s < shared.size(); )
+	{
+		int e = s;
+		while (e < shared.size() && shared[e] == shared[s]) e++;
+		pairs.push_back(std::make_pair(e - s, shared[s]));
+		s = e;
+	}
+	std::sort(pairs.begin(), pairs.end(), [](const std::pair<int, std::pair<int, int> >& x,
+		const std::pair<int, std::pair<int, int> >& y)
+		{ return x.first > y.first || (x.first == y.first && x.second < y.second); });
+
+	std::vector<char> joinedA(a.tracks + 1, 0), joinedB(b.tracks + 1, 0);
+	int baseA = 0, baseB;
+	for (int c = 0; c < k; c++)
+		baseA += chunks[c].tracks;
+	baseB = baseA + a.tracks;
+	for (int p = 0; p < pairs.size(); p++)
+	{
+		int ta = pairs[p].second.first, tb = pairs[p].second.second;
+		if (joinedA[ta] || joinedB[tb]) continue;
+		joinedA[ta] = joinedB[tb] = 1;
+		identities.unite(baseA + ta - 1, baseB + tb - 1);
+	}
+}
+
+std::vector< std::vector<BoundingBox> > ChunkedTracking::getBBoxes()
+{
+	return tracksToBoxes(*dres, indices, ids);
+}
@@ -0,0 +1,49 @@
+/*
+* Allocator of the detection columns and the graph edges
+* Without a store it's the heap, like std::allocator. With an open ColumnStore
+* the big arrays live in memory mapped files, so sequences that don't fit in
+* memory can still be tracked
+*/
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+#include "MappedFile.h"
+
+template <class T>
+class ColumnAllocator
+{
+public:
+	typedef T value_type;
+	// A container moved or swapped keeps the memory it got, so it keeps its store
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	ColumnAllocator(ColumnStore* store = NULL) : store(store) { };
+	template <class U>
+	ColumnAllocator(const ColumnAllocator<U>& other) : store(other.store) { };
+
+	T* allocate(size_t n)
+	{
+		if (store != NULL) return (T*)store->allocate(n * sizeof(T));
+		return (T*)::operator new(n * sizeof(T));
+	}
+	void deallocate(T* p, size_t)
+	{
+		if (store != NULL) store->deallocate(p);
+		else ::operator delete(p);
+	}
+
+	ColumnStore* store;
+};
+
+template <class T, class U>
+bool operator==(const ColumnAllocator<T>& a, const ColumnAllocator<U>& b) { return a.store == b.store; }
+template <class T, class U>
+bool operator!=(const ColumnAllocator<T>& a, const ColumnAllocator<U>& b) { return a.store != b.store; }
+
+/// Array of the detections or of the graph, on the heap or in a ColumnStore
+template <class T>
+using Column = std::vector<T, ColumnAllocator<T> >;
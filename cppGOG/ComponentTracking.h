@@ -0,0 +1,216 @@
+/*
+* DP tracking split over the connected components of the tracking graph
+* A track never leaves its component, and NMS only reaches boxes that overlap
+* in the same frame, so detections linked by neither are tracked independently.
+* Components are packed in a few groups of similar size, each group runs its own
+* DPTracking on the thread pool, and the tracks are merged back in the order the
+* single DP would have found them
+*/
+#pragma once
+#include <vector>
+#include <queue>
+#include <functional>
+
+#include "GOG.h"
+#include "ThreadPool.h"
+#include "UnionFind.h"
+
+class ComponentTracking
+{
+public:
+	ComponentTracking(bool nmsOn, const TrackingGraph& g, ThreadPool* pool = NULL,
+		const GOGSettings& settings = GOGSettings())
+		: nmsInLoop(nmsOn), graph(g), pool(pool), settings(settings) { };
+
+	void startTracking();
+	std::vector< std::vector<BoundingBox> > getBBoxes();
+	/// Detections kept after tracking, as indices of the graph detections
+	const std::vector<int>& getIndices() const { return indices; };
+	/// Track of every kept detection
+	const std::vector<int>& getIds() const { return ids; };
+	/// Amount of connected components found
+	int getComponentCount() const { return componentCount; };
+
+private:
+	void findGroups();
+	void merge();
+
+	/// Tracks of one group, with global indices
+	struct GroupResult
+	{
+		std::vector<int> indices;
+		// First position in "indices" of every track, plus the end of the last one
+		std::vector<int> trackStart;
+		std::vector<float> costs;
+		// Cost at which the group of detection 0 stopped on its empty track, INFINITY otherwise
+		float emptyTrackCost = INFINITY;
+	};
+
+	bool nmsInLoop;
+	// Not owned, must outlive the tracker
+	const TrackingGraph& graph;
+	ThreadPool* pool;
+	GOGSettings settings;
+
+	int componentCount;
+	// Detections of every group of components, sorted
+	std::vector< std::vector<int> > groups;
+	std::vector<GroupResult> results;
+	std::vector<int> indices;
+	std::vector<int> ids;
+};
+
+/******************************************************************************
+* COMPONENT TRACKING IMPLEMENTATION
+******************************************************************************/
+void ComponentTracking::startTracking()
+{
+	findGroups();
+	results.assign(groups.size(), GroupResult());
+
+	auto track = [&](int k)
+	{
+		const std::vector<int>& nodes = groups[k];
+		GroupResult& result = results[k];
+		if (nodes.empty()) return;
+		TrackingGraph part(graph, nodes);
+		DPTracking gog(nmsInLoop, part, settings);
+		// Only the real detection 0 keeps the special meaning it has in the whole graph
+		if (nodes[0] != 0) gog.setNoLink(-1);
+		gog.startTracking();
+
+		const std::vector<int>& local = gog.getIndices();
+		const std::vector<int>& localIds = gog.getIds();
+		result.indices.resize(local.size());
+		for (int i = 0; i < local.size(); i++)
+		{
+			result.indices[i] = nodes[local[i]];
+			if (i == 0 || localIds[i] != localIds[i - 1])
+				result.trackStart.push_back(i);
+		}
+		result.trackStart.push_back(local.size());
+		result.costs = gog.getTrackCosts();
+		result.emptyTrackCost = gog.getEmptyTrackCost();
+	};
+	if (pool != NULL)
+		pool->parallelFor(groups.size(), track);
+	else
+		for (int k = 0; k < groups.size(); k++) track(k);
+
+	merge();
+}
+
+/// Join the detections linked by an edge, and the boxes of a frame that may suppress
+/// each other. Then pack the components in groups, a few per thread of the pool
+void ComponentTracking::findGroups()
+{
+	const Detections& dres = graph.getDres();
+	int nDet = graph.size();
+	UnionFind sets(nDet);
+	for (int i = 0; i < nDet; i++)
+		for (int j : graph.getNei(i))
+			sets.unite(i, j);
+
+	if (nmsInLoop)
+	{
+		// Same test as agressiveNMS, from both boxes of every pair
+		std::vector<float> overlaps, ioa;
+		for (int i = 0; i < nDet; i++)
+		{
+			int fStart = dres.frameBegin(dres.frame[i]), fEnd = dres.frameEnd(dres.frame[i]);
+			overlaps.resize(fEnd - fStart);
+			ioa.resize(fEnd - fStart);
+			overlapOneToMany(dres.x[i], dres.y[i], dres.x[i] + dres.w[i], dres.y[i] + dres.h[i],
+				&dres.x[fStart], &dres.y[fStart], &dres.w[fStart], &dres.h[fStart], fEnd - fStart,
+				overlaps.data(), ioa.data());
+			for (int l = 0; l < fEnd - fStart; l++)
+				if ((overlaps[l] > settings.nmsThreshold) && (ioa[l] > 0.9))
+					sets.unite(i, fStart + l);
+		}
+	}
+
+	// Size of every component, kept in its first detection
+	std::vector<int> size(nDet, 0);
+	for (int i = 0; i < nDet; i++)
+		size[sets.find(i)]++;
+	std::vector<int> roots;
+	for (int i = 0; i < nDet; i++)
+		if (size[i] > 0) roots.push_back(i);
+	componentCount = roots.size();
+
+	// Biggest components first, each one to the smallest group so far
+	int groupCount = pool != NULL ? pool->size() * 4 : 1;
+	groupCount = MAX(1, MIN(groupCount, componentCount));
+	std::sort(roots.begin(), roots.end(), [&size](int a, int b) { return size[a] > size[b]; });
+	std::priority_queue< std::pair<int, int>, std::vector< std::pair<int, int> >,
+		std::greater< std::pair<int, int> > > smallest;
+	for (int k = 0; k < groupCount; k++)
+		smallest.push(std::make_pair(0, k));
+	std::vector<int> group(nDet, -1);
+	for (int r = 0; r < roots.size(); r++)
+	{
+		std::pair<int, int> g = smallest.top();
+		smallest.pop();
+		group[roots[r]] = g.second;
+		smallest.push(std::make_pair(g.first + size[roots[r]], g.second));
+	}
+
+	// Detections are visited in order, so every group comes out sorted
+	groups.assign(groupCount, std::vector<int>());
+	for (int i = 0; i < nDet; i++)
+		groups[group[sets.find(i)]].push_back(i);
+}
+
+/// The single DP takes, at every iteration, the cheapest track end of all the graph
+/// (the first one on ties). Every group found its tracks in that same order,
+/// so merging them by cost and end gives the same tracks with the same ids.
+/// The single DP stops when the empty track of detection 0 is the cheapest end, so
+/// after its last track the group of detection 0 adds that end, which stops the merge
+void ComponentTracking::merge()
+{
+	indices.clear();
+	ids.clear();
+
+	// Next track of every group: (cost, end detection, group)
+	typedef std::pair<std::pair<float, int>, int> Head;
+	std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+	std::vector<int> next(results.size(), 0);
+	auto pushNext = [&](int k)
+	{
+		const GroupResult& result = results[k];
+		int t = next[k];
+		if (t < result.costs.size())
+			heads.push(Head(std::make_pair(result.costs[t], result.indices[result.trackStart[t]]), k));
+		else if (result.emptyTrackCost != INFINITY)
+			heads.push(Head(std::make_pair(result.emptyTrackCost, 0), k));
+	};
+	for (int k = 0; k < results.size(); k++)
+		pushNext(k);
+
+	int it = 0;
+	while (!heads.empty() && it < settings.maxIterations)
+	{
+		Head head = heads.top();
+		heads.pop();
+		int k = head.second;
+		const GroupResult& result = results[k];
+		int t = next[k]++;
+		// The empty track, or only suppressed detections left, whose cheapest end is
+		// then detection 0 too. Same as the DP nothing is added
+		if (t == result.costs.size() || head.first.first == INFINITY) break;
+		it++;
+		for (int i = result.trackStart[t]; i < result.trackStart[t + 1]; i++)
+		{
+			indices.push_back(result.indices[i]);
+			ids.push_back(it);
+		}
+		// The first track over the threshold is the last one, same as the DP
+		if (head.first.first >= settings.maxTrackCost) break;
+		pushNext(k);
+	}
+}
+
+std::vector< std::vector<BoundingBox> > ComponentTracking::getBBoxes()
+{
+	return tracksToBoxes(graph.getDres(), indices, ids);
+}
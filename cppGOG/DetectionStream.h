@@ -0,0 +1,68 @@
+/*
+* Detections read while the detector is still writing them
+* Lines come from standard input or a named pipe, in the DETRAC or YOLO text
+* formats, and are grouped by frame. A frame is handed over once a line of the
+* next one arrives, or the input ends, so the tracker never sees half a frame
+*/
+#pragma once
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#include "GOG.h"
+#include "FrameQueue.h"
+#include "MappedCSV.h"
+#include "UA-DETRAC.h"
+#include "YOLO.h"
+
+namespace DetectionStream
+{
+	/// Detections of one frame
+	struct Frame
+	{
+		int number = 0;
+		Detections detections;
+	};
+
+	/// Read "input" until it ends, pushing every frame on "queue", which is closed at
+	/// the end. Meant for its own thread: it waits whenever the queue is full
+	/// False if "type" isn't "DETRAC" or "YOLO"
+	bool read_frames(std::istream& input, const char* type, FrameQueue<Frame>& queue)
+	{
+		bool yolo = 0 == strcmp(type, "YOLO");
+		if (!yolo && 0 != strcmp(type, "DETRAC"))
+		{
+			std::cout << "ERROR -> Unknown detections type " << type << std::endl;
+			queue.close();
+			return false;
+		}
+		YOLO::ImageCounter counter;
+		std::string line;
+		Detections parsed;
+		Frame current;
+		while (std::getline(input, line))
+		{
+			// Same parsing as the files, one line at a time
+			MappedCSV csv(line.data(), line.data() + line.size());
+			parsed.clear();
+			if (yolo)
+				YOLO::read_lines(csv, parsed, counter);
+			else
+				UADETRAC::read_lines(csv, parsed);
+			if (parsed.frame.empty()) continue; // Header or short line
+
+			if (!current.detections.frame.empty() && parsed.frame[0] != current.number)
+			{
+				queue.push(std::move(current));
+				current.detections.clear();
+			}
+			current.number = parsed.frame[0];
+			current.detections.append(parsed);
+		}
+		if (!current.detections.frame.empty())
+			queue.push(std::move(current));
+		queue.close();
+		return true;
+	}
+
+} // end of namespace
@@ -0,0 +1,285 @@
+/*
+* CLEAR-MOT and IDF1 metrics of the tracker output against a ground truth
+* Both are lists of boxes per frame, like DPTracking::getBBoxes gives them.
+* The overlaps of every frame are computed on the thread pool. Then, frame after
+* frame, the matches of the frame before that still overlap enough are kept, even
+* if a better box showed up, and the rest are matched with the Hungarian
+* algorithm, as CLEAR-MOT defines it
+*/
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "GOG.h"
+#include "Hungarian.h"
+#include "MappedCSV.h"
+#include "ThreadPool.h"
+#include "UnionFind.h"
+
+namespace Evaluation
+{
+	/// Counts of a whole sequence, and the metrics made from them
+	struct Metrics
+	{
+		int gtBoxes = 0;
+		int trackerBoxes = 0;
+		int matches = 0;
+		int misses = 0;
+		int falsePositives = 0;
+		int idSwitches = 0;
+		// Matches of the best one to one assignment of ground truth ids to tracker ids
+		int idTruePositives = 0;
+		double mota = 0;
+		double motp = 0;
+		double idf1 = 0;
+		double idPrecision = 0;
+		double idRecall = 0;
+	};
+
+	/// Read a ground truth in MOT format, "frame,id,x,y,w,h,...". Boxes are indexed by frame,
+	/// same as the tracker output. Lines that aren't boxes, like a header, are skipped
+	/// False if the file can't be read or is empty
+	bool read_ground_truth(const std::string& filename, std::vector< std::vector<BoundingBox> >& gt)
+	{
+		gt.clear();
+		MappedCSV file;
+		if (!file.open(filename)) return false;
+		while (file.next())
+		{
+			if (file.size() < 6) continue;
+			bool box = true;
+			for (int c = 0; c < 6; c++)
+				box = box && file.isNumber(c);
+			if (!box) continue;
+			int frame = file.toInt(0);
+			if (frame < 0) continue;
+			BoundingBox b = { file.toFloat(2), file.toFloat(3), file.toFloat(4), file.toFloat(5), file.toInt(1) };
+			if (frame >= gt.size()) gt.resize(frame + 1);
+			gt[frame].push_back(b);
+		}
+		return true;
+	}
+
+	inline float boxOverlap(const BoundingBox& a, const BoundingBox& b)
+	{
+		return intersectionOverUnion(a.x, a.y, a.x + a.w, a.y + a.h, b.x, b.y, b.x + b.w, b.y + b.h).first;
+	}
+
+	/// Pairs of a frame: (ground truth box, tracker box, IoU)
+	struct Match
+	{
+		int gt;
+		int tracker;
+		float overlap;
+	};
+
+	/// Pairs of boxes with an IoU of at least "threshold"
+	void frame_candidates(const std::vector<BoundingBox>& gt, const std::vector<BoundingBox>& tracker,
+		double threshold, std::vector<Match>& candidates)
+	{
+		candidates.clear();
+		for (int g = 0; g < gt.size(); g++)
+			for (int t = 0; t < tracker.size(); t++)
+			{
+				float overlap = boxOverlap(gt[g], tracker[t]);
+				if (overlap >= threshold) candidates.push_back(Match{ g, t, overlap });
+			}
+	}
+
+	/// Add to "matches" the assignment of the candidates whose boxes aren't matched yet that
+	/// maximizes the total IoU. "gtMatched" and "trackerMatched" tell the boxes already matched
+	void match_leftovers(const std::vector<Match>& candidates, const std::vector<char>& gtMatched,
+		const std::vector<char>& trackerMatched, std::vector<Match>& matches)
+	{
+		// Rows and columns of the boxes left with a candidate
+		std::vector<int> gtLeft, trackerLeft;
+		for (const Match& c : candidates)
+			if (!gtMatched[c.gt] && !trackerMatched[c.tracker])
+			{
+				gtLeft.push_back(c.gt);
+				trackerLeft.push_back(c.tracker);
+			}
+		if (gtLeft.empty()) return;
+		std::sort(gtLeft.begin(), gtLeft.end());
+		gtLeft.erase(std::unique(gtLeft.begin(), gtLeft.end()), gtLeft.end());
+		std::sort(trackerLeft.begin(), trackerLeft.end());
+		trackerLeft.erase(std::unique(trackerLeft.begin(), trackerLeft.end()), trackerLeft.end());
+
+		// The smaller side goes on the rows
+		bool gtRows = gtLeft.size() <= trackerLeft.size();
+		int rows = gtRows ? gtLeft.size() : trackerLeft.size(), cols = gtRows ? trackerLeft.size() : gtLeft.size();
+		// Pairs under the threshold cost more than any set of valid ones
+		std::vector<double> cost(rows * cols, rows + 1);
+		std::vector<float> overlaps(rows * cols, 0);
+		for (const Match& c : candidates)
+		{
+			if (gtMatched[c.gt] || trackerMatched[c.tracker]) continue;
+			int g = std::lower_bound(gtLeft.begin(), gtLeft.end(), c.gt) - gtLeft.begin();
+			int t = std::lower_bound(trackerLeft.begin(), trackerLeft.end(), c.tracker) - trackerLeft.begin();
+			int cell = gtRows ? g * cols + t : t * cols + g;
+			cost[cell] = 1 - c.overlap;
+			overlaps[cell] = c.overlap;
+		}
+
+		std::vector<int> match;
+		minCostAssignment(cost, rows, cols, match);
+		for (int r = 0; r < rows; r++)
+		{
+			int cell = r * cols + match[r];
+			if (cost[cell] > 1) continue;
+			int g = gtRows ? r : match[r], t = gtRows ? match[r] : r;
+			matches.push_back(Match{ gtLeft[g], trackerLeft[t], overlaps[cell] });
+		}
+	}
+
+	/// Metrics of "tracker" against "gt", both indexed by frame. Pairs of boxes need an IoU of at
+	/// least "threshold" to match
+	Metrics evaluate(const std::vector< std::vector<BoundingBox> >& gt,
+		const std::vector< std::vector<BoundingBox> >& tracker, ThreadPool* pool = NULL, double threshold = 0.5)
+	{
+		Metrics m;
+		int frames = MAX(gt.size(), tracker.size());
+		const std::vector<BoundingBox> none;
+		std::vector< std::vector<Match> > candidates(frames);
+		auto frameCandidates = [&](int f)
+		{
+			frame_candidates(f < gt.size() ? gt[f] : none, f < tracker.size() ? tracker[f] : none, threshold,
+				candidates[f]);
+		};
+		if (pool != NULL)
+			pool->parallelFor(frames, frameCandidates);
+		else
+			for (int f = 0; f < frames; f++) frameCandidates(f);
+
+		// Ids of both sides as consecutive numbers, ground truth first
+		std::vector<int> gtIds, trackerIds;
+		for (int f = 0; f < frames; f++)
+		{
+			if (f < gt.size())
+				for (const BoundingBox& b : gt[f]) gtIds.push_back(b.id);
+			if (f < tracker.size())
+				for (const BoundingBox& b : tracker[f]) trackerIds.push_back(b.id);
+		}
+		m.gtBoxes = gtIds.size();
+		m.trackerBoxes = trackerIds.size();
+		std::sort(gtIds.begin(), gtIds.end());
+		gtIds.erase(std::unique(gtIds.begin(), gtIds.end()), gtIds.end());
+		std::sort(trackerIds.begin(), trackerIds.end());
+		trackerIds.erase(std::unique(trackerIds.begin(), trackerIds.end()), trackerIds.end());
+		int nGt = gtIds.size(), nTracker = trackerIds.size();
+		auto gtNode = [&](int id) { return std::lower_bound(gtIds.begin(), gtIds.end(), id) - gtIds.begin(); };
+		auto trackerNode = [&](int id) { return nGt + (std::lower_bound(trackerIds.begin(), trackerIds.end(), id) - trackerIds.begin()); };
+
+		// CLEAR-MOT: a ground truth object switches id when matched to another track than the last time
+		std::vector<int> lastTracker(nGt, -1);
+		// Track matched to every ground truth object in the frame before, -1 if none
+		std::vector<int> previous(nGt, -1);
+		std::vector<int> previousGt;
+		std::vector<char> gtMatched, trackerMatched;
+		std::vector<Match> matches;
+		double overlapSum = 0;
+		// Every (ground truth, tracker) pair that overlaps, once per frame, for IDF1
+		std::vector< std::pair<int, int> > pairs;
+		for (int f = 0; f < frames; f++)
+		{
+			gtMatched.assign(f < gt.size() ? gt[f].size() : 0, 0);
+			trackerMatched.assign(f < tracker.size() ? tracker[f].size() : 0, 0);
+			matches.clear();
+			// Matches of the frame before still valid are kept
+			for (const Match& c : candidates[f])
+			{
+				int g = gtNode(gt[f][c.gt].id), t = trackerNode(tracker[f][c.tracker].id);
+				pairs.push_back(std::make_pair(g, t));
+				if (previous[g] != t || gtMatched[c.gt] || trackerMatched[c.tracker]) continue;
+				gtMatched[c.gt] = trackerMatched[c.tracker] = 1;
+				matches.push_back(c);
+			}
+			match_leftovers(candidates[f], gtMatched, trackerMatched, matches);
+
+			for (int g : previousGt)
+				previous[g] = -1;
+			previousGt.clear();
+			for (const Match& match : matches)
+			{
+				int g = gtNode(gt[f][match.gt].id), t = trackerNode(tracker[f][match.tracker].id);
+				if (lastTracker[g] != -1 && lastTracker[g] != t) m.idSwitches++;
+				lastTracker[g] = t;
+				previous[g] = t;
+				previousGt.push_back(g);
+				overlapSum += match.overlap;
+			}
+			m.matches += matches.size();
+		}
+		m.misses = m.gtBoxes - m.matches;
+		m.falsePositives = m.trackerBoxes - m.matches;
+		m.mota = m.gtBoxes > 0 ? 1 - (double)(m.misses + m.falsePositives + m.idSwitches) / m.gtBoxes : 0;
+		m.motp = m.matches > 0 ? overlapSum / m.matches : 0;
+
+		// IDF1: one to one assignment of ids that maximizes the frames they share.
+		// Ids that never overlap are independent, so every connected group is solved on its own
+		std::sort(pairs.begin(), pairs.end());
+		std::vector< std::pair<std::pair<int, int>, int> > shared;
+		for (int s = 0; s < pairs.size(); )
+		{
+			int e = s;
+			while (e < pairs.size() && pairs[e] == pairs[s]) e++;
+			shared.push_back(std::make_pair(pairs[s], e - s));
+			s = e;
+		}
+		UnionFind sets(nGt + nTracker);
+		for (int s = 0; s < shared.size(); s++)
+			sets.unite(shared[s].first.first, shared[s].first.second);
+		std::vector< std::vector<int> > groups(nGt + nTracker);
+		for (int s = 0; s < shared.size(); s++)
+			groups[sets.find(shared[s].first.first)].push_back(s);
+
+		for (int r = 0; r < groups.size(); r++)
+		{
+			const std::vector<int>& group = groups[r];
+			if (group.empty()) continue;
+			std::vector<int> rowsOf, colsOf;
+			for (int s : group)
+			{
+				rowsOf.push_back(shared[s].first.first);
+				colsOf.push_back(shared[s].first.second);
+			}
+			std::sort(rowsOf.begin(), rowsOf.end());
+			rowsOf.erase(std::unique(rowsOf.begin(), rowsOf.end()), rowsOf.end());
+			std::sort(colsOf.begin(), colsOf.end());
+			colsOf.erase(std::unique(colsOf.begin(), colsOf.end()), colsOf.end());
+			bool gtRows = rowsOf.size() <= colsOf.size();
+			if (!gtRows) rowsOf.swap(colsOf);
+			int rows = rowsOf.size(), cols = colsOf.size();
+			std::vector<double> cost(rows * cols, 0);
+			for (int s : group)
+			{
+				int a = shared[s].first.first, b = shared[s].first.second;
+				if (!gtRows) std::swap(a, b);
+				int row = std::lower_bound(rowsOf.begin(), rowsOf.end(), a) - rowsOf.begin();
+				int col = std::lower_bound(colsOf.begin(), colsOf.end(), b) - colsOf.begin();
+				cost[row * cols + col] = -shared[s].second;
+			}
+			std::vector<int> match;
+			minCostAssignment(cost, rows, cols, match);
+			for (int row = 0; row < rows; row++)
+				m.idTruePositives -= (int)cost[row * cols + match[row]];
+		}
+		m.idPrecision = m.trackerBoxes > 0 ? (double)m.idTruePositives / m.trackerBoxes : 0;
+		m.idRecall = m.gtBoxes > 0 ? (double)m.idTruePositives / m.gtBoxes : 0;
+		m.idf1 = m.gtBoxes + m.trackerBoxes > 0 ? 2.0 * m.idTruePositives / (m.gtBoxes + m.trackerBoxes) : 0;
+		return m;
+	}
+
+	void print_metrics(const Metrics& m)
+	{
+		std::cout << "MOTA : " << m.mota * 100 << " MOTP : " << m.motp * 100 << " IDF1 : " << m.idf1 * 100
+			<< " IDP : " << m.idPrecision * 100 << " IDR : " << m.idRecall * 100 << std::endl;
+		std::cout << "Ground truth boxes : " << m.gtBoxes << " Tracker boxes : " << m.trackerBoxes
+			<< " Matches : " << m.matches << " Misses : " << m.misses << " False positives : " << m.falsePositives
+			<< " Id switches : " << m.idSwitches << std::endl;
+	}
+
+} // end of namespace
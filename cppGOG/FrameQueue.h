@@ -0,0 +1,75 @@
+/*
+* Bounded queue between one producer thread and one consumer thread
+* A ring of "capacity" slots and two counters, each one written by a single
+* side, so no lock is taken. A full queue makes the producer wait, which holds
+* back whoever feeds it instead of buffering without limit. The side waiting
+* yields, then sleeps a little, so a slow producer doesn't keep a core busy
+*/
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <utility>
+
+template <class T>
+class FrameQueue
+{
+public:
+	FrameQueue(int capacity) : slots(capacity < 1 ? 1 : capacity), head(0), tail(0), closed(false) { };
+	FrameQueue(const FrameQueue&) = delete;
+	FrameQueue& operator=(const FrameQueue&) = delete;
+
+	/// Producer: add "item" at the end, waiting while the queue is full
+	void push(T&& item);
+	/// Producer: there won't be more items
+	void close() { closed.store(true, std::memory_order_release); };
+	/// Consumer: take the first item, waiting while the queue is empty. False once
+	/// the queue is closed and every item was taken
+	bool pop(T& item);
+
+private:
+	static void wait(int& tries)
+	{
+		if (tries++ < 64) std::this_thread::yield();
+		else std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+
+	std::vector<T> slots;
+	// Items taken and items added since the beginning. Slot of item "i" is i % capacity
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+	std::atomic<bool> closed;
+};
+
+/******************************************************************************
+* FRAME QUEUE IMPLEMENTATION
+******************************************************************************/
+template <class T>
+void FrameQueue<T>::push(T&& item)
+{
+	size_t t = tail.load(std::memory_order_relaxed);
+	int tries = 0;
+	while (t - head.load(std::memory_order_acquire) >= slots.size())
+		wait(tries);
+	// Swapped, so the item left in the slot gives its memory back to the producer
+	std::swap(slots[t % slots.size()], item);
+	tail.store(t + 1, std::memory_order_release);
+}
+
+template <class T>
+bool FrameQueue<T>::pop(T& item)
+{
+	size_t h = head.load(std::memory_order_relaxed);
+	int tries = 0;
+	while (h == tail.load(std::memory_order_acquire))
+	{
+		// Closed is set after the last push, so one more look finds any item left
+		if (closed.load(std::memory_order_acquire) && h == tail.load(std::memory_order_acquire))
+			return false;
+		wait(tries);
+	}
+	std::swap(item, slots[h % slots.size()]);
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
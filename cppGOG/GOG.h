@@ -6,6 +6,14 @@
 #include <vector>
 #include <algorithm>
 
+#include "AllocationCounter.h"
+#include "ColumnAllocator.h"
+#include "IndexedHeap.h"
+#include "OriginIndex.h"
+#include "Overlap.h"
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+
 /******************************************************************************
 * STRUCT DEFINITIONS
 ******************************************************************************/
@@ -13,17 +21,44 @@
 struct Detections
 {
 	// x-component of top left coordinate
-	std::vector<float> x;
+	Column<float> x;
 	// y-component of top left coordinate
-	std::vector<float> y;
+	Column<float> y;
 	// width of the box section
-	std::vector<float> w;
+	Column<float> w;
 	// height of the box section
-	std::vector<float> h;
+	Column<float> h;
 	// Score of the detection
-	std::vector<float> score;
+	Column<float> score;
 	// frame of the detection
-	std::vector<int> frame;
+	Column<int> frame;
+	// Index of the first detection of every frame from "firstFrame" on, plus the end
+	// of the last one. Built by indexFrames once all the detections are loaded
+	std::vector<int> frameOffsets;
+	int firstFrame = 0;
+
+	/// With an open store, the columns are kept in mapped files
+	Detections(ColumnStore* store = NULL)
+		: x(ColumnAllocator<float>(store)), y(ColumnAllocator<float>(store)), w(ColumnAllocator<float>(store)),
+		h(ColumnAllocator<float>(store)), score(ColumnAllocator<float>(store)), frame(ColumnAllocator<int>(store)) { };
+
+	void indexFrames();
+	bool framesIndexed() const;
+	/// Room for "n" detections in every column
+	void reserve(size_t n);
+	/// Add the detections of "block" at the end, with "frameShift" added to their frames
+	void append(const Detections& block, int frameShift = 0);
+	/// Remove every detection, keeping the memory of the columns
+	void clear();
+	/// First detection of frame "f", or where it would be if it has none
+	int frameBegin(int f) const
+	{
+		if (frameOffsets.empty()) return 0;
+		f -= firstFrame;
+		return frameOffsets[f < 0 ? 0 : (f >= (int)frameOffsets.size() ? frameOffsets.size() - 1 : f)];
+	}
+	/// One past the last detection of frame "f"
+	int frameEnd(int f) const { return frameBegin(f + 1); }
 };
 
 /// Datastructure only used for showing the results
@@ -41,6 +76,19 @@ struct BoundingBox
 	int id;
 };
 
+/// Non-owning view of a contiguous list of indices
+struct IndexSpan
+{
+	const int* first;
+	const int* last;
+
+	const int* begin() const { return first; }
+	const int* end() const { return last; }
+	int size() const { return last - first; }
+	bool empty() const { return first == last; }
+	int operator[](int i) const { return first[i]; }
+};
+
 /// Settings structure for the tracker
 struct GOGSettings
 {
@@ -56,6 +104,11 @@ struct GOGSettings
 	float maxIterations;
 	// Maximum acceptable cost for a track. Matlab name: thr_cost
 	int maxTrackCost;
+	// Overlap over which a box of a track suppresses the other boxes of its frame
+	double nmsThreshold;
+	// Take the following tracks without a pass for each one, while the pass can't
+	// change them. The tracks are the same, with less passes over the graph
+	bool batchExtraction;
 
 	/// Default constructor for default configuration
 	GOGSettings()
@@ -66,6 +119,8 @@ struct GOGSettings
 		betta = 0.01; // Original value = 0.2
 		maxIterations = INFINITY; // Original value = inf 
 		maxTrackCost = 18; // Original value = 18
+		nmsThreshold = 0.5; // Original value = 0.5
+		batchExtraction = false;
 	}
 };
 
@@ -98,6 +153,29 @@ inline std::pair<float, float> intersectionOverUnion(
 	}
 }
 
+/// Boxes of the detections "indices" of "dres", with the track in "ids", grouped by frame
+std::vector< std::vector<BoundingBox> > tracksToBoxes(const Detections& dres,
+	const std::vector<int>& indices, const std::vector<int>& ids)
+{
+	std::vector< std::vector<BoundingBox> > seqBoxes;
+	// Amount of frames
+	int lastFrame = 0;
+	for (int i = 0; i < indices.size(); i++)
+		lastFrame = MAX(lastFrame, dres.frame[indices[i]]);
+
+	// Frames are used as indices, the last frame doesn't fit and is left out
+	seqBoxes.resize(lastFrame);
+	for (int i = 0; i < indices.size(); i++)
+	{
+		int d = indices[i];
+		if (dres.frame[d] >= lastFrame) continue;
+		BoundingBox b = { dres.x[d], dres.y[d], dres.w[d], dres.h[d], ids[i] };
+		seqBoxes[dres.frame[d]].push_back(b);
+	}
+
+	return seqBoxes;
+}
+
 /******************************************************************************
 * CLASSES DEFINITION
 ******************************************************************************/
@@ -105,20 +183,54 @@ inline std::pair<float, float> intersectionOverUnion(
 class TrackingGraph
 {
 public:
-	TrackingGraph(Detections detections);
+	TrackingGraph(const Detections& detections, ThreadPool* pool = NULL);
+	TrackingGraph(Detections&& detections, ThreadPool* pool = NULL);
+	TrackingGraph(int retention = 0);
+	TrackingGraph(const TrackingGraph& whole, const std::vector<int>& nodes);
+	// The graph may point to its own detections, so it can't be copied
+	TrackingGraph(const TrackingGraph&) = delete;
+	TrackingGraph& operator=(const TrackingGraph&) = delete;
 
-	void buildGraph();
-	Detections getDres() { return dres; };
-	std::vector< std::vector<int> > getNei() { return neighbors; };
+	void buildGraph(ThreadPool* pool = NULL);
+	int appendFrame(const Detections& frameDetections, int frame);
+	const Detections& getDres() const { return *dres; };
+	/// Neighbors in the previous frame of the detection "index"
+	IndexSpan getNei(int index) const
+	{
+		IndexSpan nei = { neiEdges.data() + neiOffsets[index], neiEdges.data() + neiOffsets[index + 1] };
+		return nei;
+	};
+	/// Amount of detections with a list of neighbors
+	int size() const { return neiOffsets.size() - 1; };
+	/// Count "bytes" of the graph as read, for the memory budget of an out-of-core graph
+	void touch(size_t bytes) const
+	{
+		if (neiEdges.get_allocator().store != NULL) neiEdges.get_allocator().store->touch(bytes);
+	};
 
 private:
-	// Same name as in the matlab implementation. Stores all the detected boxes
-	Detections dres;
+	void linkFrameRange(int firstFrame, int lastFrame, SpatialGrid& grid,
+		Column<int>& offsets, Column<int>& edges);
+	void linkFrames(int pfStart, int pfEnd, int afStart, int afEnd, SpatialGrid& grid,
+		Column<int>& offsets, Column<int>& edges);
+
+	// Same name as in the matlab implementation. All the detected boxes, not owned
+	// by the graph, except when they're moved in or added with appendFrame
+	const Detections* dres;
+	// Detections moved in or added with appendFrame
+	Detections owned;
 	// Threshold for overlapping of detected boxes. Original value = 0.5
 	double ovThreshold = 0.3;
-	// Same name as in the matlab implementation. Stores the graph edges,
-	// the transitions between different detections
-	std::vector< std::vector<int> > neighbors;
+	// Same as "neighbors" in the matlab implementation. Stores the graph edges,
+	// the transitions between different detections, in compressed rows: the
+	// neighbors of detection "i" are neiEdges[neiOffsets[i]] to neiEdges[neiOffsets[i+1] - 1]
+	// They're kept in the same store as the detections
+	Column<int> neiOffsets;
+	Column<int> neiEdges;
+	// Frames kept when the graph is built with appendFrame. 0 keeps all of them
+	int retention;
+	// Reused by appendFrame
+	SpatialGrid grid;
 
 };
 
@@ -127,16 +239,38 @@ class DPTracking
 {
 public:
 
-	DPTracking(bool nmsOn, TrackingGraph g, const GOGSettings& settings = GOGSettings())
-		: nmsInLoop(nmsOn), graph(g),
+	DPTracking(bool nmsOn, const TrackingGraph& g, const GOGSettings& settings = GOGSettings())
+		: nmsInLoop(nmsOn), graph(&g),
 		birthCost(settings.birthCost), deathCost(settings.deathCost),
 		transitionCost(settings.transitionCost), betta(settings.betta),
-		maxIterations(settings.maxIterations), maxTrackCost(settings.maxTrackCost) { };
+		maxIterations(settings.maxIterations), maxTrackCost(settings.maxTrackCost),
+		nmsThreshold(settings.nmsThreshold), batchExtraction(settings.batchExtraction),
+		noLink(0), loopAllocations(0), passes(0), emptyTrackCost(INFINITY) { };
 
 	void startTracking();
-	std::vector<int> agressiveNMS(Detections dres, std::vector<int> inds, double nmsThreshold);
-	void setResults(Detections dres, std::vector<int> indices);
+	/// Track another graph with the same settings. The buffers of the last run are kept,
+	/// so once they fit the biggest sequence, tracking doesn't allocate
+	void reset(const TrackingGraph& g);
+	void agressiveNMS(const Detections& dres, const std::vector<int>& inds, double nmsThreshold,
+		std::vector<int>& inds_out);
+	void setResults(const Detections& dres, const std::vector<int>& indices);
 	std::vector< std::vector<BoundingBox> > getBBoxes();
+	/// Detections kept after tracking, as indices of the graph detections
+	const std::vector<int>& getIndices() const { return indices; };
+	/// Track of every kept detection
+	const std::vector<int>& getIds() const { return ids; };
+	/// Cost of every track, in the order they were found
+	const std::vector<float>& getTrackCosts() const { return trackCosts; };
+	/// Heap allocations done inside the tracking loop. Only counted in debug builds
+	long long getLoopAllocations() const { return loopAllocations; };
+	/// Passes over the nodes to redo done by the last run
+	int getPasses() const { return passes; };
+	/// Cost of the empty track of detection 0 when it was the cheapest end and stopped
+	/// the tracking. INFINITY if something else stopped it, or nothing was left to track
+	float getEmptyTrackCost() const { return emptyTrackCost; };
+	/// Link of the detections that start a track. With the default 0, detection 0
+	/// can't be part of a track, like in the original implementation
+	void setNoLink(int value) { noLink = value; };
 
 private:
 	int birthCost;
@@ -145,107 +279,416 @@ private:
 	double betta;
 	float maxIterations;
 	int maxTrackCost;
+	double nmsThreshold;
+	bool batchExtraction;
 	bool nmsInLoop;
+	int noLink;
 
-	TrackingGraph graph;
+	// Not owned, must outlive the tracker
+	const TrackingGraph* graph;
 	Detections result;
+	std::vector<int> indices;
 	std::vector<int> ids;
+	std::vector<float> trackCosts;
+	long long loopAllocations;
+	int passes;
+	float emptyTrackCost;
+	// Scratch memory of agressiveNMS
+	std::vector<float> nmsOverlaps, nmsIoa;
+
+	/// Working memory of startTracking, kept from one run to the next
+	struct Scratch
+	{
+		std::vector<float> c, dp_c, min_cs; // Same names as Matlab implementation
+		std::vector<int> dp_link, redo_nodes, inds, inds_all, id_s, supp_inds; // Same names as Matlab implementation
+		OriginIndex orig;
+		std::vector<bool> suppressed;
+		std::vector<int> auxNodes;
+		std::vector<float> auxNeiInds;
+		IndexedMinHeap deathHeap;
+		// Batch extraction: marks of the nodes waiting for the next pass, and the track being checked
+		std::vector<char> pending;
+		std::vector<int> resolveNodes, candInds, candSupp, candRedo;
+	} scratch;
+
+	void relaxNode(int index);
+	void resolvePending(const std::vector<int>& nodes);
+	void extractIndependent(const Detections& dres, float& min_c, int& it, int& k);
 };
 
+/******************************************************************************
+* DETECTIONS IMPLEMENTATION
+******************************************************************************/
+/// Build the frame offsets table. Detections must be sorted by frame
+void Detections::indexFrames()
+{
+	int n = frame.size();
+	frameOffsets.clear();
+	firstFrame = n == 0 ? 0 : frame.front();
+	if (n == 0) return;
+
+	int frames = frame.back() - firstFrame + 1;
+	frameOffsets.resize(frames + 1);
+	int i = 0;
+	for (int f = 0; f <= frames; f++)
+	{
+		while (i < n && frame[i] < firstFrame + f) i++;
+		frameOffsets[f] = i;
+	}
+}
+
+void Detections::reserve(size_t n)
+{
+	x.reserve(n);
+	y.reserve(n);
+	w.reserve(n);
+	h.reserve(n);
+	score.reserve(n);
+	frame.reserve(n);
+}
+
+void Detections::append(const Detections& block, int frameShift)
+{
+	x.insert(x.end(), block.x.begin(), block.x.end());
+	y.insert(y.end(), block.y.begin(), block.y.end());
+	w.insert(w.end(), block.w.begin(), block.w.end());
+	h.insert(h.end(), block.h.begin(), block.h.end());
+	score.insert(score.end(), block.score.begin(), block.score.end());
+	for (int i = 0; i < block.frame.size(); i++)
+		frame.push_back(block.frame[i] + frameShift);
+}
+
+void Detections::clear()
+{
+	x.clear();
+	y.clear();
+	w.clear();
+	h.clear();
+	score.clear();
+	frame.clear();
+	frameOffsets.clear();
+	firstFrame = 0;
+}
+
+/// True when the frame offsets table covers all the detections
+bool Detections::framesIndexed() const
+{
+	if (frameOffsets.empty() || frame.empty()) return frame.empty();
+	return frameOffsets.front() == 0 && frameOffsets.back() == frame.size() &&
+		frame.front() >= firstFrame && frame.back() - firstFrame + 1 < frameOffsets.size();
+}
+
 /******************************************************************************
 * GRAPH IMPLEMENTATION
 ******************************************************************************/
-TrackingGraph::TrackingGraph(Detections detections)
+/// With a pool, frames are linked in parallel. The graph is the same either way
+/// The detections are not copied, they must outlive the graph. Only when their
+/// frames are not indexed the graph indexes its own copy
+TrackingGraph::TrackingGraph(const Detections& detections, ThreadPool* pool) : dres(&detections), retention(0)
+{
+	if (!detections.framesIndexed())
+	{
+		owned = detections;
+		owned.indexFrames();
+		dres = &owned;
+	}
+	buildGraph(pool);
+}
+
+/// Takes the detections, for callers that don't need them anymore
+TrackingGraph::TrackingGraph(Detections&& detections, ThreadPool* pool)
+	: dres(&owned), owned(std::move(detections)), retention(0)
+{
+	if (!owned.framesIndexed())
+		owned.indexFrames();
+	buildGraph(pool);
+}
+
+/// Empty graph, to be filled frame by frame with appendFrame. Only the
+/// last "retention" frames are kept (all of them if 0)
+TrackingGraph::TrackingGraph(int retention) : dres(&owned), retention(retention)
+{
+	neiOffsets.assign(1, 0);
+}
+
+/// Part of another graph: the detections "nodes", sorted, and the edges between them.
+/// Every neighbor of a node must be in "nodes", like in a connected component
+TrackingGraph::TrackingGraph(const TrackingGraph& whole, const std::vector<int>& nodes)
+	: dres(&owned), retention(0)
 {
-	dres = detections;
-	buildGraph();
+	const Detections& from = whole.getDres();
+	int n = nodes.size();
+	owned.x.resize(n); owned.y.resize(n);
+	owned.w.resize(n); owned.h.resize(n);
+	owned.score.resize(n); owned.frame.resize(n);
+	neiOffsets.assign(1, 0);
+	for (int k = 0; k < n; k++)
+	{
+		int i = nodes[k];
+		owned.x[k] = from.x[i]; owned.y[k] = from.y[i];
+		owned.w[k] = from.w[i]; owned.h[k] = from.h[i];
+		owned.score[k] = from.score[i]; owned.frame[k] = from.frame[i];
+		// Neighbors keep their order, since the nodes are sorted
+		for (int j : whole.getNei(i))
+			neiEdges.push_back(std::lower_bound(nodes.begin(), nodes.end(), j) - nodes.begin());
+		neiOffsets.push_back(neiEdges.size());
+	}
+	owned.indexFrames();
 }
 
 /// Here we model the tracking as a Graph based on the detections
-void TrackingGraph::buildGraph()
+void TrackingGraph::buildGraph(ThreadPool* pool)
+{
+	int nDet = dres->frame.size(); // Number of detections
+	int lastFrame = dres->frame.empty() ? 0 : dres->frame.back(); // Sorted by frame
+
+	ColumnStore* store = dres->frame.get_allocator().store;
+	if (neiEdges.get_allocator().store != store)
+	{
+		neiOffsets = Column<int>(ColumnAllocator<int>(store));
+		neiEdges = Column<int>(ColumnAllocator<int>(store));
+	}
+	neiOffsets.assign(1, 0);
+	neiEdges.clear();
+	// Detections of the first frame don't have neighbors
+	if (lastFrame >= 2)
+		neiOffsets.resize(1 + dres->frameEnd(1) - dres->frameBegin(1), 0);
+
+	// Frames 2 to lastFrame are split in blocks linked independently, and
+	// appended to the graph in order
+	int blocks = 1;
+	if (pool != NULL)
+		blocks = MIN(lastFrame - 1, pool->size() * 4);
+	if (blocks <= 1)
+	{
+		SpatialGrid grid;
+		linkFrameRange(2, lastFrame, grid, neiOffsets, neiEdges);
+	}
+	else
+	{
+		std::vector< Column<int> > blockOffsets(blocks), blockEdges(blocks);
+		pool->parallelFor(blocks, [&](int b)
+		{
+			int from = 2 + (int)((long long)(lastFrame - 1) * b / blocks);
+			int to = 1 + (int)((long long)(lastFrame - 1) * (b + 1) / blocks);
+			SpatialGrid grid;
+			linkFrameRange(from, to, grid, blockOffsets[b], blockEdges[b]);
+		});
+		for (int b = 0; b < blocks; b++)
+		{
+			int base = neiEdges.size();
+			neiEdges.insert(neiEdges.end(), blockEdges[b].begin(), blockEdges[b].end());
+			for (int i = 0; i < blockOffsets[b].size(); i++)
+				neiOffsets.push_back(base + blockOffsets[b][i]);
+		}
+	}
+
+	// Detections after the last linked frame don't have neighbors
+	if (neiOffsets.size() < nDet + 1)
+		neiOffsets.resize(nDet + 1, neiEdges.size());
+
+}
+
+/// Add the detections of "frame", which must come after the frames already in the graph.
+/// Only the edges to the previous frame are computed. Frames out of the retention
+/// window are removed, and the amount of detections removed is returned, since
+/// the indices of the remaining ones move back by that amount
+int TrackingGraph::appendFrame(const Detections& frameDetections, int frame)
+{
+	if (!dres->frame.empty() && dres->frame.back() >= frame)
+	{
+		std::cout << "ERROR -> Frame " << frame << " added after frame " << dres->frame.back() << std::endl;
+		return 0;
+	}
+	// A graph built from someone else's detections needs its own copy to grow
+	if (dres != &owned)
+	{
+		owned = *dres;
+		dres = &owned;
+	}
+
+	// Detections of the previous frame, if it's in the graph
+	int afStart = dres->frame.size();
+	int pfStart = afStart, pfEnd = afStart;
+	if (!dres->frame.empty() && dres->frame.back() == frame - 1)
+		pfStart = dres->frameBegin(frame - 1);
+
+	for (int i = 0; i < frameDetections.x.size(); i++)
+	{
+		owned.x.push_back(frameDetections.x[i]);
+		owned.y.push_back(frameDetections.y[i]);
+		owned.w.push_back(frameDetections.w[i]);
+		owned.h.push_back(frameDetections.h[i]);
+		owned.score.push_back(frameDetections.score[i]);
+		owned.frame.push_back(frame);
+	}
+	// The frames skipped since the last one have no detections
+	if (owned.frameOffsets.empty())
+	{
+		owned.firstFrame = frame;
+		owned.frameOffsets.push_back(afStart);
+	}
+	owned.frameOffsets.resize(frame - owned.firstFrame + 2, afStart);
+	owned.frameOffsets.back() = owned.frame.size();
+	linkFrames(pfStart, pfEnd, afStart, dres->frame.size(), grid, neiOffsets, neiEdges);
+
+	if (retention <= 0) return 0;
+	// Remove the frames that left the window
+	int newFirst = frame - retention + 1;
+	int old = dres->frameBegin(newFirst);
+	if (old == 0) return 0;
+	owned.x.erase(owned.x.begin(), owned.x.begin() + old);
+	owned.y.erase(owned.y.begin(), owned.y.begin() + old);
+	owned.w.erase(owned.w.begin(), owned.w.begin() + old);
+	owned.h.erase(owned.h.begin(), owned.h.begin() + old);
+	owned.score.erase(owned.score.begin(), owned.score.begin() + old);
+	owned.frame.erase(owned.frame.begin(), owned.frame.begin() + old);
+	owned.frameOffsets.erase(owned.frameOffsets.begin(), owned.frameOffsets.begin() + (newFirst - owned.firstFrame));
+	for (int i = 0; i < owned.frameOffsets.size(); i++)
+		owned.frameOffsets[i] -= old;
+	owned.firstFrame = newFirst;
+
+	// The new first frame loses its edges, which pointed to removed detections.
+	// The graph is then the same as one built from the remaining frames
+	int firstEnd = dres->frame.empty() ? 0 : dres->frameEnd(dres->frame[0]);
+	int cut = neiOffsets[old + firstEnd];
+	neiEdges.erase(neiEdges.begin(), neiEdges.begin() + cut);
+	for (int i = 0; i < neiEdges.size(); i++)
+		neiEdges[i] -= old;
+	neiOffsets.erase(neiOffsets.begin(), neiOffsets.begin() + old);
+	for (int i = 0; i < neiOffsets.size(); i++)
+		neiOffsets[i] = i <= firstEnd ? 0 : neiOffsets[i] - cut;
+	return old;
+}
+
+/// Link every frame of [firstFrame, lastFrame] to the one before it
+void TrackingGraph::linkFrameRange(int firstFrame, int lastFrame, SpatialGrid& grid,
+	Column<int>& offsets, Column<int>& edges)
 {
-	int nDet = dres.frame.size(); // Number of detections
-	int frame = 2; // Start from the 2nd frame
-	std::vector<int> ovBoxes; // Indices of overlapping boxes with a specific box
-	int lastFrame = *std::max_element(dres.frame.begin(), dres.frame.end());
-	float IoU, ratio, min_ratio;
+	for (int frame = firstFrame; frame <= lastFrame; frame++)
+	{
+		// Detections of the previous frame, and of the actual frame
+		int edgesBefore = edges.size();
+		linkFrames(dres->frameBegin(frame - 1), dres->frameEnd(frame - 1),
+			dres->frameBegin(frame), dres->frameEnd(frame), grid, offsets, edges);
+		// Six columns of both frames read, and the new edges and offsets written
+		touch((dres->frameEnd(frame) - dres->frameBegin(frame - 1)) * 6 * sizeof(float)
+			+ (edges.size() - edgesBefore + dres->frameEnd(frame) - dres->frameBegin(frame)) * sizeof(int));
+	} // end for frame
+}
 
-	// Iterators used to find the detections of frames
-	int pfStart, pfEnd, afStart, afEnd;
-	std::pair<std::vector<int>::iterator, std::vector<int>::iterator> pfBounds, afBounds;
+/// Append to "edges" the list of neighbors in the previous frame [pfStart, pfEnd)
+/// of every detection in the actual frame [afStart, afEnd), and the end of each list to "offsets"
+void TrackingGraph::linkFrames(int pfStart, int pfEnd, int afStart, int afEnd, SpatialGrid& grid,
+	Column<int>& offsets, Column<int>& edges)
+{
+	std::vector<int> candidates; // Boxes of the previous frame that may overlap
+	std::vector<float> candX, candY, candW, candH; // Copy of the candidate boxes, to compute overlaps at once
+	std::vector<float> overlaps, ioa;
+	const float *px = NULL, *py = NULL, *pw = NULL, *ph = NULL; // Boxes given to the overlap kernel
+	float ratio, min_ratio;
 
-	for (frame; frame <= lastFrame; frame++)
+	// Only boxes sharing a cell of the grid can overlap. If the grid can't be
+	// built every box of the previous frame is a candidate
+	bool useGrid = grid.build(dres->x.data(), dres->y.data(), dres->w.data(), dres->h.data(), pfStart, pfEnd);
+	if (!useGrid)
 	{
-		// Indices for detections of the previous frame
-		pfBounds = std::equal_range(dres.frame.begin(), dres.frame.end(), frame - 1);
-		pfStart = pfBounds.first - dres.frame.begin();
-		pfEnd = pfBounds.second - dres.frame.begin();
-		// Indices for detections of actual frame
-		afBounds = std::equal_range(dres.frame.begin(), dres.frame.end(), frame);
-		afStart = afBounds.first - dres.frame.begin();
-		afEnd = afBounds.second - dres.frame.begin();
-		// If we are looking at the first two frames
-		if (frame == 2)
+		for (int i = pfStart; i < pfEnd; i++) candidates.push_back(i);
+		// The candidates are contiguous, no need to copy them
+		px = dres->x.data() + pfStart; py = dres->y.data() + pfStart;
+		pw = dres->w.data() + pfStart; ph = dres->h.data() + pfStart;
+	}
+
+	// For all the detections in the actual frame
+	for (afStart; afStart < afEnd; afStart++)
+	{
+		if (useGrid)
 		{
-			for (pfStart; pfStart < pfEnd; pfStart++)
+			grid.query(dres->x[afStart], dres->y[afStart],
+				dres->x[afStart] + dres->w[afStart], dres->y[afStart] + dres->h[afStart], candidates);
+			candX.clear(); candY.clear(); candW.clear(); candH.clear();
+			for (int c = 0; c < candidates.size(); c++)
 			{
-				neighbors.push_back(ovBoxes);
+				candX.push_back(dres->x[candidates[c]]); candY.push_back(dres->y[candidates[c]]);
+				candW.push_back(dres->w[candidates[c]]); candH.push_back(dres->h[candidates[c]]);
 			}
+			px = candX.data(); py = candY.data(); pw = candW.data(); ph = candH.data();
 		}
-		// For all the detections in the actual frame
-		for (afStart; afStart < afEnd; afStart++)
+		// Calculate the overlap with the candidate detections in previous frame
+		overlaps.resize(candidates.size());
+		ioa.resize(candidates.size());
+		overlapOneToMany(dres->x[afStart], dres->y[afStart], dres->x[afStart] + dres->w[afStart], dres->y[afStart] + dres->h[afStart],
+			px, py, pw, ph, candidates.size(), overlaps.data(), ioa.data());
+		for (int c = 0; c < candidates.size(); c++)
 		{
-			pfStart = pfBounds.first - dres.frame.begin();
-			// Calculate the overlap with all the detections in previous frame
-			for (pfStart; pfStart < pfEnd; pfStart++)
+			pfStart = candidates[c];
+			// Ignore transitions with large change in bb size
+			ratio = dres->h[afStart] / dres->h[pfStart];
+			min_ratio = MIN(ratio, 1 / ratio);
+			// Find all the boxes that are > overlapThreshold
+			if (overlaps[c] > ovThreshold && min_ratio > 0.8)
 			{
-				// Find all the boxes that are > overlapThreshold
-				IoU = intersectionOverUnion(
-					dres.x[pfStart], dres.y[pfStart], dres.x[pfStart] + dres.w[pfStart], dres.y[pfStart] + dres.h[pfStart],
-					dres.x[afStart], dres.y[afStart], dres.x[afStart] + dres.w[afStart], dres.y[afStart] + dres.h[afStart]
-				).first; // First always has the IoU
-						 // Ignore transitions with large change in bb size
-				ratio = dres.h[afStart] / dres.h[pfStart];
-				min_ratio = MIN(ratio, 1 / ratio);
-				if (IoU > ovThreshold && min_ratio > 0.8)
-				{
-					ovBoxes.push_back(pfStart); // Make a list of indices of overlapped boxes
-				}
+				edges.push_back(pfStart); // Make a list of indices of overlapped boxes
 			}
-			// Populate "neighbors" with a list of neighbors in the previous frame for that detection
-			neighbors.push_back(ovBoxes);
-			ovBoxes.clear();
-		} // end for actual frame detections
-	} // end for frame
-
+		}
+		// Close the list of neighbors in the previous frame for that detection
+		offsets.push_back(edges.size());
+	} // end for actual frame detections
 }
 
 /******************************************************************************
 * TRACKING ALGORITHM IMPLEMENTATION
 ******************************************************************************/
+/// Forget the results of the last run, not its buffers
+void DPTracking::reset(const TrackingGraph& g)
+{
+	graph = &g;
+	result.x.clear();
+	result.y.clear();
+	result.w.clear();
+	result.h.clear();
+	result.score.clear();
+	result.frame.clear();
+	indices.clear();
+	ids.clear();
+	trackCosts.clear();
+	loopAllocations = 0;
+	passes = 0;
+	emptyTrackCost = INFINITY;
+}
+
 void DPTracking::startTracking()
 {
 	// Auxiliary variables
 	std::vector<float>::iterator iteF; // Auxiliary iterator
 	std::vector<int>::iterator iteI, auxIteI; // Auxiliary iterator
-	Detections dres = graph.getDres();
+	const Detections& dres = graph->getDres();
 
-	std::vector< std::vector<int> > nei = graph.getNei();
-	std::vector<int> auxInds, auxNodes;
-	std::vector<float> auxNeiInds;
+	// The buffers come from the scratch, so they keep the capacity of the last run
+	std::vector<int>& auxNodes = scratch.auxNodes;
+	std::vector<float>& auxNeiInds = scratch.auxNeiInds;
+	IndexedMinHeap& deathHeap = scratch.deathHeap; // Keeps "dp_c + deathCost" sorted, to find the best track end
 
 	// Actual variables used for tracking
-	double nmsThreshold = 0.5;
 	int dnum = dres.x.size(); // Will always hold the original amount of detections
-	std::vector<float> c, dp_c, dp_link, min_cs; // Same names as Matlab implementation
-	std::vector<int> orig, redo_nodes, inds, inds_all, id_s, supp_inds; // Same names as Matlab implementation
-	std::vector<int> neiInds; // List of indices of each detection (the vector inside "nei vector") 
+	std::vector<float>& c = scratch.c, &dp_c = scratch.dp_c, &min_cs = scratch.min_cs; // Same names as Matlab implementation
+	std::vector<int>& dp_link = scratch.dp_link; // Detection before in the best track, "noLink" for none
+	std::vector<int>& redo_nodes = scratch.redo_nodes, &inds = scratch.inds, &inds_all = scratch.inds_all,
+		&id_s = scratch.id_s, &supp_inds = scratch.supp_inds; // Same names as Matlab implementation
+	OriginIndex& orig = scratch.orig; // Same name as Matlab implementation, also knows the nodes of every origin
+	std::vector<bool>& suppressed = scratch.suppressed; // Marks "supp_inds", for the setdiff
+	IndexSpan neiInds; // List of neighbors of each detection
 
-	for (iteF = dres.score.begin(); iteF <= dres.score.end(); iteF++)
-		c.push_back(betta - *iteF); // betta - score
+	c.clear();
+	redo_nodes.clear();
+	inds_all.clear();
+	id_s.clear();
+	min_cs.clear();
+	for (int i = 0; i < dnum; i++)
+		c.push_back(betta - dres.score[i]); // betta - score
 
 	float min_c = -INFINITY, min_cost = INFINITY;
-	int min_link, it = 0, k = 0, k1 = 0;
+	int min_link, it = 0, k = 0;
 	// nodesAmount will always hold the size of "redo_nodes"
 	int nodesAmount, index;
 	int jIndex; // Hold the index for the min cost path
@@ -258,26 +701,53 @@ void DPTracking::startTracking()
 	// Initialize the vectors with the same size as redo_nodes at the beginning
 	dp_c.resize(nodesAmount);
 	dp_link.resize(nodesAmount);
-	orig.resize(nodesAmount);
+	orig.reset(nodesAmount);
+	suppressed.assign(nodesAmount, false);
+	// Reserve everything the loop needs, so it doesn't allocate. Every detection
+	// ends at most in one track
+	auxNodes.reserve(dnum);
+	auxNeiInds.reserve(dnum);
+	deathHeap.reserve(dnum);
+	inds.reserve(dnum);
+	supp_inds.reserve(dnum);
+	inds_all.reserve(dnum);
+	id_s.reserve(dnum);
+	min_cs.reserve(dnum + 1);
+	nmsOverlaps.reserve(dnum);
+	nmsIoa.reserve(dnum);
+	if (batchExtraction)
+	{
+		scratch.pending.assign(dnum, 0);
+		scratch.resolveNodes.reserve(dnum);
+		scratch.candInds.reserve(dnum);
+		scratch.candSupp.reserve(dnum);
+		scratch.candRedo.reserve(dnum);
+	}
+	passes = 0;
+	emptyTrackCost = INFINITY;
+#ifdef _DEBUG
+	long long allocationsBefore = allocationCount;
+#endif
 
 	while ((min_c < maxTrackCost) && (it < maxIterations))
 	{
 		// Arrays in Matlab start at index 1, that's the reason for this i++ at beginning
 		it++;
+		passes++;
 
 		nodesAmount = redo_nodes.size();
 		for (iteI = redo_nodes.begin(); iteI < redo_nodes.end(); iteI++)
 		{
 			dp_c[*iteI] = c[*iteI] + birthCost; // not the same value as matlab, because of vector C
-			dp_link[*iteI] = 0;
-			orig[*iteI] = *iteI;
+			dp_link[*iteI] = noLink;
+			orig.assign(*iteI, *iteI);
 		}
 
 		// Next for same as "for ii=1:length(redo_nodes)"
 		for (int i = 0; i < nodesAmount; i++)
 		{
 			index = redo_nodes[i];
-			neiInds = nei[index];
+			neiInds = graph->getNei(index);
 			if (neiInds.empty()) continue;
 
 			// Reset the min_cost for the new index
@@ -295,33 +765,42 @@ void DPTracking::startTracking()
 			{
 				dp_c[index] = min_cost;
 				dp_link[index] = min_link;
-				orig[index] = orig[min_link];
+				orig.assign(index, orig[min_link]);
 			}
 		} // end of for redo_nodes size (nodesAmount variable)
 
 		// Next section same as "[min_c ind] = min(dres.dp_c + c_ex);"
+		// The heap is built once, then only the nodes relaxed or suppressed are updated
 		int ind = 0;
-		auxNeiInds.clear();
-		for (int j = 0; j < dp_c.size(); j++)
-			auxNeiInds.push_back(dp_c[j] + deathCost);
-
-		iteF = std::min_element(auxNeiInds.begin(), auxNeiInds.end());
-		min_c = *iteF; // Get the value
-		ind = iteF - auxNeiInds.begin(); // Get the index
+		if (passes == 1)
+		{
+			auxNeiInds.clear();
+			for (int j = 0; j < dp_c.size(); j++)
+				auxNeiInds.push_back(dp_c[j] + deathCost);
+			deathHeap.assign(auxNeiInds);
+		}
+		else
+		{
+			for (int i = 0; i < nodesAmount; i++)
+				deathHeap.update(redo_nodes[i], dp_c[redo_nodes[i]] + deathCost);
+		}
+		min_c = deathHeap.topKey(); // Get the value
+		ind = deathHeap.top(); // Get the index
 
-		// Next for same as "inds = zeros(dnum,1);". Reset the "inds" vector to all zeros
+		// Next lines same as "inds = zeros(dnum,1);" and the loop filling it,
+		// without the zeros since the track is usually short
 		inds.clear();
-		for (int i = 0; i < dnum; i++)
-			inds.push_back(0);
-
-		k1 = 0;
-		while (ind != 0)
+		while (ind != noLink)
 		{
-			inds[k1] = ind;
+			inds.push_back(ind);
 			ind = dp_link[ind];
-			k1++;
 		}
-		inds.resize(k1); // Make the vector shorter
+		// The best end is the first detection, which can't start a track. Nothing left to do
+		if (inds.empty())
+		{
+			emptyTrackCost = min_c;
+			break;
+		}
 
 		// Add inds values to inds_all
 		inds_all.insert(inds_all.end(), inds.begin(), inds.end());
@@ -331,55 +810,210 @@ void DPTracking::startTracking()
 		// Use Non-Maximum Suppression
 		if (nmsInLoop)
 		{
-			supp_inds = agressiveNMS(dres, inds, nmsThreshold);
+			agressiveNMS(dres, inds, nmsThreshold, supp_inds);
 			// Next line same as "unique(dres.orig(supp_inds));" because it always have the same number
-			int origs = orig[supp_inds[0]]; // The whole vector has the same number
-			// Next for same as "find(ismember(dres.orig, origs));"			
-			for (iteI = orig.begin(); iteI < orig.end(); iteI++)
-				if (*iteI == origs)	auxInds.push_back(iteI - orig.begin());
-
-			redo_nodes = auxInds;
-			auxInds.clear();
+			// A box with no area doesn't even suppress itself, then the track end is used
+			int origs = supp_inds.empty() ? orig[inds[0]] : orig[supp_inds[0]]; // The whole vector has the same number
+			// Next line same as "find(ismember(dres.orig, origs));"
+			orig.members(origs, redo_nodes);
 		}
 		else // Not use of NMS
 		{
 			supp_inds = inds;
 			int origs = inds.back();
-			// Next for is same as "redo_nodes = find(dres.orig == origs);"
-			for (iteI = orig.begin(); iteI < orig.end(); iteI++)
-				if (*iteI == origs) auxInds.push_back(iteI - orig.begin());
-
-			redo_nodes = auxInds;
-			auxInds.clear();
+			// Next line is same as "redo_nodes = find(dres.orig == origs);"
+			orig.members(origs, redo_nodes);
 		} // end if nms is active
 
 		  // Next for same as "redo_nodes = setdiff(redo_nodes, supp_inds);"
 		auxNodes.clear(); // Keep the vector clean for this iteration
 		// Look for all the elements in redo_nodes that are not in supp_inds
+		for (iteI = supp_inds.begin(); iteI < supp_inds.end(); iteI++)
+			suppressed[*iteI] = true;
 		for (iteI = redo_nodes.begin(); iteI < redo_nodes.end(); iteI++)
-			if (find(supp_inds.begin(), supp_inds.end(), *iteI) == supp_inds.end())
+			if (!suppressed[*iteI])
 				auxNodes.push_back(*iteI);
-		redo_nodes = auxNodes;
+		for (iteI = supp_inds.begin(); iteI < supp_inds.end(); iteI++)
+			suppressed[*iteI] = false;
+		redo_nodes.swap(auxNodes);
 
 		for (iteI = supp_inds.begin(); iteI < supp_inds.end(); iteI++)
 		{
 			dp_c[*iteI] = INFINITY;
 			c[*iteI] = INFINITY;
+			deathHeap.update(*iteI, INFINITY);
 		}
 
 		min_cs.push_back(min_c);
+		if (batchExtraction)
+			extractIndependent(dres, min_c, it, k);
+		// The nodes redone and the boxes of the track are spread over the graph, each
+		// one may bring a whole page of edges, and NMS a page of every column of its frame
+		graph->touch((nodesAmount + inds.size() * 6) * ColumnStore::pageSize);
 	} // end of while
+#ifdef _DEBUG
+	loopAllocations = allocationCount - allocationsBefore;
+#endif
 
 	// Return a subset of the detections, same as "sub(dres, inds_all);" 
 	setResults(dres, inds_all); // REVIEW THIS FUNCTION
+	indices = inds_all;
 	ids = id_s;
+	trackCosts = min_cs;
+}
+
+/// Same as one node of the pass of startTracking
+void DPTracking::relaxNode(int index)
+{
+	Scratch& s = scratch;
+	s.dp_c[index] = s.c[index] + birthCost;
+	s.dp_link[index] = noLink;
+	s.orig.assign(index, index);
+	IndexSpan neiInds = graph->getNei(index);
+	if (neiInds.empty()) return;
+
+	s.auxNeiInds.clear();
+	for (int j = 0; j < neiInds.size(); j++)
+		s.auxNeiInds.push_back(transitionCost + s.c[index] + s.dp_c[neiInds[j]]);
+	std::vector<float>::iterator iteF = std::min_element(s.auxNeiInds.begin(), s.auxNeiInds.end());
+	if (s.dp_c[index] > *iteF)
+	{
+		s.dp_c[index] = *iteF;
+		s.dp_link[index] = neiInds[iteF - s.auxNeiInds.begin()];
+		s.orig.assign(index, s.orig[s.dp_link[index]]);
+	}
+}
+
+/// Relax the pending "nodes" now, with the pending nodes they link to. Neighbors are in
+/// frames before, so ascending order is the order of the pass
+void DPTracking::resolvePending(const std::vector<int>& nodes)
+{
+	Scratch& s = scratch;
+	s.resolveNodes.clear();
+	for (int node : nodes)
+	{
+		if (s.pending[node] != 1) continue;
+		s.pending[node] = 2;
+		s.resolveNodes.push_back(node);
+	}
+	for (int i = 0; i < s.resolveNodes.size(); i++)
+	{
+		IndexSpan neiInds = graph->getNei(s.resolveNodes[i]);
+		for (int j = 0; j < neiInds.size(); j++)
+		{
+			if (s.pending[neiInds[j]] != 1) continue;
+			s.pending[neiInds[j]] = 2;
+			s.resolveNodes.push_back(neiInds[j]);
+		}
+	}
+	std::sort(s.resolveNodes.begin(), s.resolveNodes.end());
+	for (int node : s.resolveNodes)
+	{
+		relaxNode(node);
+		s.pending[node] = 0;
+		s.deathHeap.update(node, s.dp_c[node] + deathCost);
+	}
+	graph->touch(s.resolveNodes.size() * ColumnStore::pageSize);
+}
+
+/// Take the tracks the next iterations would take, before the pass. The nodes to redo
+/// wait in the heap with their old key: a pass only makes keys grow, so while the top
+/// isn't one of them it's the same end the pass would give. A pending node on top is
+/// relaxed on its own. The pass is still needed for a track that suppresses boxes of
+/// another origin, since the nodes that link to them are only redone if they're in it
+void DPTracking::extractIndependent(const Detections& dres, float& min_c, int& it, int& k)
+{
+	Scratch& s = scratch;
+	for (int node : s.redo_nodes)
+		s.pending[node] = 1;
+
+	while ((min_c < maxTrackCost) && (it < maxIterations))
+	{
+		int end = s.deathHeap.top();
+		if (s.pending[end] != 0)
+		{
+			s.candInds.assign(1, end);
+			resolvePending(s.candInds);
+			continue;
+		}
+		float key = s.deathHeap.topKey();
+
+		s.candInds.clear();
+		bool independent = true;
+		for (int ind = end; ind != noLink; ind = s.dp_link[ind])
+		{
+			independent = independent && s.pending[ind] == 0;
+			s.candInds.push_back(ind);
+		}
+		// An empty track ends the tracking, the pass finds it again
+		if (!independent || s.candInds.empty()) break;
+
+		int origs;
+		if (nmsInLoop)
+		{
+			agressiveNMS(dres, s.candInds, nmsThreshold, s.candSupp);
+			resolvePending(s.candSupp);
+			origs = s.candSupp.empty() ? s.orig[s.candInds[0]] : s.orig[s.candSupp[0]];
+		}
+		else
+		{
+			s.candSupp = s.candInds;
+			origs = s.candInds.back();
+		}
+		for (int node : s.candSupp)
+			independent = independent && s.orig[node] == origs;
+		if (!independent) break;
+
+		// Same steps as the loop of startTracking
+		it++;
+		min_c = key;
+		s.inds_all.insert(s.inds_all.end(), s.candInds.begin(), s.candInds.end());
+		s.id_s.insert(s.id_s.end(), s.candInds.size(), it);
+		k += s.candInds.size();
+
+		s.orig.members(origs, s.candRedo);
+		for (int node : s.candSupp) s.suppressed[node] = true;
+		for (int node : s.candRedo)
+		{
+			if (s.suppressed[node] || s.pending[node] != 0) continue;
+			s.pending[node] = 1;
+			s.redo_nodes.push_back(node);
+		}
+		for (int node : s.candSupp) s.suppressed[node] = false;
+
+		for (int node : s.candSupp)
+		{
+			s.dp_c[node] = INFINITY;
+			s.c[node] = INFINITY;
+			s.deathHeap.update(node, INFINITY);
+		}
+		s.min_cs.push_back(min_c);
+		graph->touch(s.candInds.size() * 6 * ColumnStore::pageSize);
+	}
+
+	// The pass redoes the nodes still pending
+	int kept = 0;
+	for (int node : s.redo_nodes)
+	{
+		if (s.pending[node] == 0) continue;
+		s.pending[node] = 0;
+		s.redo_nodes[kept++] = node;
+	}
+	s.redo_nodes.resize(kept);
+	std::sort(s.redo_nodes.begin(), s.redo_nodes.end());
 }
 
 /// Take only the "most important" detections, and discard the rest
-void DPTracking::setResults(Detections dres, std::vector<int> indices)
+void DPTracking::setResults(const Detections& dres, const std::vector<int>& indices)
 {
-	std::vector<int>::iterator iteI; // Auxiliary iterator
+	std::vector<int>::const_iterator iteI; // Auxiliary iterator
 
+	result.x.reserve(result.x.size() + indices.size());
+	result.y.reserve(result.y.size() + indices.size());
+	result.w.reserve(result.w.size() + indices.size());
+	result.h.reserve(result.h.size() + indices.size());
+	result.score.reserve(result.score.size() + indices.size());
+	result.frame.reserve(result.frame.size() + indices.size());
 	for (iteI = indices.begin(); iteI < indices.end(); iteI++)
 	{
 		result.x.push_back(dres.x[*iteI]);
@@ -389,73 +1023,40 @@ void DPTracking::setResults(Detections dres, std::vector<int> indices)
 		result.score.push_back(dres.score[*iteI]);
 		result.frame.push_back(dres.frame[*iteI]);
 	}
-	std::cout << "Result size > " << result.x.size() << std::endl;
 }
 
-std::vector<int> DPTracking::agressiveNMS(Detections dres, std::vector<int> inds, double nmsThreshold)
+/// Indices of the detections suppressed by the boxes of a track, written in "inds_out"
+void DPTracking::agressiveNMS(const Detections& dres, const std::vector<int>& inds, double nmsThreshold,
+	std::vector<int>& inds_out)
 {
-	/// Auxiliary variables
-	std::vector<int>::iterator iteI; // Integer iterator
-	std::vector<int> auxInds;
-	std::vector<float> overlaps;
-	/// Actual useful variables
-	std::vector<int> inds_out, frameDetections;
-	int zeros = dres.x.size();
-	int f1, k = 0, frame;
-	std::pair<float, float> ovResult;
-	std::vector<int> f2;
-
-	// "inds_out" starts with all zeros
-	for (int i = 0; i < zeros; i++)
-		inds_out.push_back(0);
+	int f1, frame;
+	int fStart, fEnd; // Detections of the frame
 
+	inds_out.clear();
 	int indsLength = inds.size();
 	for (int i = 0; i < indsLength; i++)
 	{
 		f1 = inds[i];
 		frame = dres.frame[f1];
-		frameDetections.clear();
-		// Next for same as "f2 = find(dres.fr == dres.fr(f1));"
-		// Indices of all detections of the same frame
-		for (int j = 0; j < dres.frame.size(); j++)
-			if (dres.frame[j] == frame) frameDetections.push_back(j);
+		// Next lines same as "f2 = find(dres.fr == dres.fr(f1));"
+		// Detections are sorted by frame, so the ones of the same frame are contiguous
+		fStart = dres.frameBegin(frame);
+		fEnd = dres.frameEnd(frame);
 
-		for (int l = 0; l < frameDetections.size(); l++)
+		nmsOverlaps.resize(fEnd - fStart);
+		nmsIoa.resize(fEnd - fStart);
+		overlapOneToMany(dres.x[f1], dres.y[f1], dres.x[f1] + dres.w[f1], dres.y[f1] + dres.h[f1],
+			&dres.x[fStart], &dres.y[fStart], &dres.w[fStart], &dres.h[fStart], fEnd - fStart,
+			nmsOverlaps.data(), nmsIoa.data());
+		for (int l = 0; l < fEnd - fStart; l++)
 		{
-			ovResult = intersectionOverUnion(
-				dres.x[f1], dres.y[f1], dres.x[f1] + dres.w[f1], dres.y[f1] + dres.h[f1],
-				dres.x[frameDetections[l]], dres.y[frameDetections[l]],
-				dres.x[frameDetections[l]] + dres.w[frameDetections[l]], dres.y[frameDetections[l]] + dres.h[frameDetections[l]]
-			);
-			if ((ovResult.first > nmsThreshold) && (ovResult.second > 0.9))
-			{
-				inds_out[k] = frameDetections[l];
-				k++;
-			}
+			if ((nmsOverlaps[l] > nmsThreshold) && (nmsIoa[l] > 0.9))
+				inds_out.push_back(fStart + l);
 		} // end of for detections of frame
 	}
-	// THE SIZE OF THIS inds_out MUST MATCH THE SIZE OF inds
-	inds_out.resize(k);
-	return inds_out;
 }
 
 std::vector< std::vector<BoundingBox> > DPTracking::getBBoxes()
 {
-	std::vector< std::vector<BoundingBox> > seqBoxes;
-	std::vector<BoundingBox> frameBoxes;
-	// Amount of frames
-	int lastFrame = *std::max_element(result.frame.begin(), result.frame.end());
-	// Amount of boxes
-	int lastBox = result.x.size();
-
-	for (int i = 0; i < lastFrame; i++)
-		seqBoxes.push_back(frameBoxes);
-
-	for (int i = 0; i < lastBox; i++)
-	{
-		BoundingBox b = { result.x[i], result.y[i], result.w[i], result.h[i], ids[i] };
-		seqBoxes[result.frame[i]].push_back(b);
-	}
-
-	return seqBoxes;
+	return tracksToBoxes(graph->getDres(), indices, ids);
 }
@@ -0,0 +1,69 @@
+/*
+* Minimum cost assignment of the rows of a matrix to its columns
+* Hungarian algorithm with potentials, O(rows^2 * cols). Every row gets a
+* different column, so there can't be more rows than columns
+*/
+#pragma once
+#include <vector>
+#include <cmath>
+
+/// "cost" holds rows * cols values, row after row. Fills "match" with the column of every row
+void minCostAssignment(const std::vector<double>& cost, int rows, int cols, std::vector<int>& match)
+{
+	match.assign(rows, -1);
+	if (rows == 0 || rows > cols) return;
+
+	// Same names as the usual formulation: rows and columns start at 1, column 0 is a dummy
+	std::vector<double> u(rows + 1, 0), v(cols + 1, 0), minv(cols + 1);
+	std::vector<int> p(cols + 1, 0), way(cols + 1, 0);
+	std::vector<char> used(cols + 1);
+	for (int i = 1; i <= rows; i++)
+	{
+		p[0] = i;
+		int j0 = 0;
+		minv.assign(cols + 1, INFINITY);
+		used.assign(cols + 1, 0);
+		do
+		{
+			used[j0] = 1;
+			int i0 = p[j0], j1 = 0;
+			double delta = INFINITY;
+			for (int j = 1; j <= cols; j++)
+			{
+				if (used[j]) continue;
+				double reduced = cost[(i0 - 1) * cols + (j - 1)] - u[i0] - v[j];
+				if (reduced < minv[j])
+				{
+					minv[j] = reduced;
+					way[j] = j0;
+				}
+				if (minv[j] < delta)
+				{
+					delta = minv[j];
+					j1 = j;
+				}
+			}
+			for (int j = 0; j <= cols; j++)
+			{
+				if (used[j])
+				{
+					u[p[j]] += delta;
+					v[j] -= delta;
+				}
+				else
+					minv[j] -= delta;
+			}
+			j0 = j1;
+		} while (p[j0] != 0);
+		// Flip the augmenting path
+		do
+		{
+			int j1 = way[j0];
+			p[j0] = p[j1];
+			j0 = j1;
+		} while (j0 != 0);
+	}
+
+	for (int j = 1; j <= cols; j++)
+		if (p[j] != 0) match[p[j] - 1] = j - 1;
+}
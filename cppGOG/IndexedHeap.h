@@ -0,0 +1,112 @@
+/*
+* Binary min-heap over the items 0 to n-1, where the key of any item can be changed
+* Ties are broken by the smallest item, same as std::min_element over the keys
+*/
+#pragma once
+#include <vector>
+
+template <class Key>
+class IndexedHeap
+{
+public:
+	void assign(const std::vector<Key>& keys);
+	void reserve(int n);
+	void update(int item, Key newKey);
+
+	/// Item with the smallest key
+	int top() const { return heap[0]; };
+	/// Smallest key
+	Key topKey() const { return key[heap[0]]; };
+	bool empty() const { return heap.empty(); };
+
+private:
+	bool before(int a, int b) const { return key[a] < key[b] || (key[a] == key[b] && a < b); };
+	void siftUp(int position);
+	void siftDown(int position);
+
+	// Key of every item
+	std::vector<Key> key;
+	// Items in heap order
+	std::vector<int> heap;
+	// Position of every item in "heap"
+	std::vector<int> position;
+};
+
+/// Heap used by the DP, keys have the precision of its costs
+typedef IndexedHeap<float> IndexedMinHeap;
+
+/******************************************************************************
+* INDEXED HEAP IMPLEMENTATION
+******************************************************************************/
+/// Build the heap with one item per key. Memory is reused between calls
+template <class Key>
+void IndexedHeap<Key>::assign(const std::vector<Key>& keys)
+{
+	int n = keys.size();
+	key = keys;
+	heap.resize(n);
+	position.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		heap[i] = i;
+		position[i] = i;
+	}
+	for (int i = n / 2 - 1; i >= 0; i--)
+		siftDown(i);
+}
+
+/// Room for "n" items, so assign doesn't allocate
+template <class Key>
+void IndexedHeap<Key>::reserve(int n)
+{
+	key.reserve(n);
+	heap.reserve(n);
+	position.reserve(n);
+}
+
+/// Change the key of "item" and restore the heap order in O(log n)
+template <class Key>
+void IndexedHeap<Key>::update(int item, Key newKey)
+{
+	Key oldKey = key[item];
+	key[item] = newKey;
+	if (newKey < oldKey)
+		siftUp(position[item]);
+	else
+		siftDown(position[item]);
+}
+
+template <class Key>
+void IndexedHeap<Key>::siftUp(int pos)
+{
+	int item = heap[pos];
+	while (pos > 0)
+	{
+		int parent = (pos - 1) / 2;
+		if (!before(item, heap[parent])) break;
+		heap[pos] = heap[parent];
+		position[heap[pos]] = pos;
+		pos = parent;
+	}
+	heap[pos] = item;
+	position[item] = pos;
+}
+
+template <class Key>
+void IndexedHeap<Key>::siftDown(int pos)
+{
+	int n = heap.size();
+	int item = heap[pos];
+	while (true)
+	{
+		int child = 2 * pos + 1;
+		if (child >= n) break;
+		if (child + 1 < n && before(heap[child + 1], heap[child])) child++;
+		if (!before(heap[child], item)) break;
+		heap[pos] = heap[child];
+		position[heap[pos]] = pos;
+		pos = child;
+	}
+	heap[pos] = item;
+	position[item] = pos;
+}
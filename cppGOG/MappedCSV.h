@@ -0,0 +1,208 @@
+/*
+* CSV file read in place
+* The file is memory mapped and every line is split at its commas without
+* copying it, the fields are only pointers into the mapping. Numbers are read
+* with the same results as std::stoi and std::stof, the common ones without
+* going through the C library. A file can be split at newlines, to read
+* every part on its own thread
+*/
+#pragma once
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "MappedFile.h"
+
+class MappedCSV
+{
+public:
+	MappedCSV() : position(NULL), end(NULL), fields(0) { };
+	/// Bytes "from" to "to" of the lines left in "whole", which has to stay open
+	MappedCSV(const MappedCSV& whole, size_t from, size_t to)
+		: position(whole.position + from), end(whole.position + to), fields(0) { };
+	/// Lines from "begin" to "end" of a buffer, which has to stay alive
+	MappedCSV(const char* begin, const char* end) : position(begin), end(end), fields(0) { };
+
+	/// False if the file can't be read or is empty
+	bool open(const std::string& filename);
+	/// Lines of the file, counting a last one without a newline
+	size_t countLines() const;
+	/// Split the lines left in "parts" of about the same size, without cutting any line.
+	/// "bounds" gets where every part starts, and the end
+	void split(int parts, std::vector<size_t>& bounds) const;
+	/// Split the next line in fields. False at the end of the file
+	bool next();
+
+	/// Fields of the line, same as CSVRow::size
+	int size() const { return fields; };
+	/// Same as "row[i] == text"
+	bool equals(int i, const char* text) const;
+	bool equals(int i, const std::string& text) const
+	{
+		return ends[i] - starts[i] == text.size() && memcmp(starts[i], text.data(), text.size()) == 0;
+	};
+	/// Same as "row[i] = text", keeping the text after the file moves on
+	void copy(int i, std::string& text) const { text.assign(starts[i], ends[i] - starts[i]); };
+	/// Same as std::stoi(row[i]), 0 if it's not a number
+	int toInt(int i) const;
+	/// Same as std::stof(row[i]), 0 if it's not a number
+	float toFloat(int i) const;
+	/// False where std::stoi and std::stof would throw: no digits after the spaces and the sign
+	bool isNumber(int i) const;
+
+	static const int maxFields = 16;
+
+private:
+	MappedFile file;
+	const char* position;
+	const char* end;
+	int fields;
+	const char* starts[maxFields];
+	const char* ends[maxFields];
+
+	float slowFloat(int i) const;
+	void copyField(int i, char* buffer, size_t size) const;
+};
+
+/******************************************************************************
+* MAPPED CSV IMPLEMENTATION
+******************************************************************************/
+bool MappedCSV::open(const std::string& filename)
+{
+	fields = 0;
+	if (!file.open(filename)) return false;
+	position = (const char*)file.data();
+	end = position + file.size();
+	return true;
+}
+
+size_t MappedCSV::countLines() const
+{
+	size_t lines = 0;
+	const char* p = position;
+	while (p < end)
+	{
+		const char* newline = (const char*)memchr(p, '\n', end - p);
+		lines++;
+		if (newline == NULL) break;
+		p = newline + 1;
+	}
+	return lines;
+}
+
+void MappedCSV::split(int parts, std::vector<size_t>& bounds) const
+{
+	size_t size = end - position;
+	bounds.assign(1, 0);
+	for (int p = 1; p < parts; p++)
+	{
+		// The part ends after the first newline past its share
+		size_t at = std::max(size / parts * p, bounds.back());
+		const char* newline = at < size ? (const char*)memchr(position + at, '\n', size - at) : NULL;
+		bounds.push_back(newline != NULL ? newline - position + 1 : size);
+	}
+	bounds.push_back(size);
+}
+
+bool MappedCSV::next()
+{
+	if (position >= end) return false;
+	const char* newline = (const char*)memchr(position, '\n', end - position);
+	const char* lineEnd = newline != NULL ? newline : end;
+	// Same cells as getline on ',': the carriage return stays in the last one, and
+	// a trailing comma gives an empty cell
+	fields = 0;
+	const char* start = position;
+	while (fields < maxFields)
+	{
+		const char* comma = (const char*)memchr(start, ',', lineEnd - start);
+		starts[fields] = start;
+		ends[fields] = comma != NULL ? comma : lineEnd;
+		fields++;
+		if (comma == NULL) break;
+		start = comma + 1;
+	}
+	position = newline != NULL ? newline + 1 : end;
+	return true;
+}
+
+bool MappedCSV::equals(int i, const char* text) const
+{
+	size_t length = strlen(text);
+	return ends[i] - starts[i] == length && memcmp(starts[i], text, length) == 0;
+}
+
+int MappedCSV::toInt(int i) const
+{
+	const char* p = starts[i];
+	const char* last = ends[i];
+	bool negative = p < last && *p == '-';
+	if (p < last && (*p == '-' || *p == '+')) p++;
+	if (p == last || *p < '0' || *p > '9')
+	{
+		// Spaces before the number, or no number at all
+		char buffer[64];
+		copyField(i, buffer, sizeof(buffer));
+		return (int)strtol(buffer, NULL, 10);
+	}
+	long long value = 0;
+	// Like stoi, it stops at the first character that isn't a digit
+	for (; p < last && *p >= '0' && *p <= '9'; p++)
+		value = value * 10 + (*p - '0');
+	return (int)(negative ? -value : value);
+}
+
+float MappedCSV::toFloat(int i) const
+{
+	// Powers of ten exactly representable as a float
+	static const float powers[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+	const char* p = starts[i];
+	const char* last = ends[i];
+	bool negative = p < last && *p == '-';
+	if (p < last && (*p == '-' || *p == '+')) p++;
+
+	// Decimal numbers, "-12.345": all the digits as an integer and the amount of decimals
+	long long mantissa = 0;
+	int digits = 0, decimals = 0;
+	for (; p < last && *p >= '0' && *p <= '9' && digits < 18; p++, digits++)
+		mantissa = mantissa * 10 + (*p - '0');
+	if (p < last && *p == '.')
+		for (p++; p < last && *p >= '0' && *p <= '9' && digits < 18; p++, digits++, decimals++)
+			mantissa = mantissa * 10 + (*p - '0');
+	// An exponent, more digits, "inf", "nan", spaces... go through strtof
+	bool stops = p == last || !((*p >= '0' && *p <= '9') || *p == 'e' || *p == 'E' || *p == 'x' || *p == 'X');
+	if (digits == 0 || !stops || mantissa > (1 << 24) || decimals > 10)
+		return slowFloat(i);
+	// Both are exact floats, so the division is correctly rounded, same as strtof
+	float value = (float)mantissa / powers[decimals];
+	return negative ? -value : value;
+}
+
+bool MappedCSV::isNumber(int i) const
+{
+	const char* p = starts[i];
+	const char* last = ends[i];
+	while (p < last && isspace((unsigned char)*p)) p++;
+	if (p < last && (*p == '-' || *p == '+')) p++;
+	if (p < last && *p == '.') p++;
+	return p < last && *p >= '0' && *p <= '9';
+}
+
+float MappedCSV::slowFloat(int i) const
+{
+	char buffer[64];
+	copyField(i, buffer, sizeof(buffer));
+	return strtof(buffer, NULL);
+}
+
+/// Field "i" as a C string, for the C library
+void MappedCSV::copyField(int i, char* buffer, size_t size) const
+{
+	size_t length = ends[i] - starts[i];
+	if (length >= size) length = size - 1;
+	memcpy(buffer, starts[i], length);
+	buffer[length] = '\0';
+}
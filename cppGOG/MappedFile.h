@@ -0,0 +1,265 @@
+/*
+* Memory backed by files on disk
+* A MappedFile is a temporary file mapped in memory, removed when closed, or an
+* existing file mapped to be read without copying it. A ColumnStore
+* hands out big blocks of memory as mapped files and keeps the pages resident
+* under a budget: once more than the budget was touched, every page is released,
+* and read back from the file (usually still in the page cache) when used again
+*/
+#pragma once
+#include <iostream>
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+class MappedFile
+{
+public:
+	MappedFile() : bytes(0), address(NULL) { };
+	~MappedFile() { close(); };
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool create(const std::string& folder, size_t size);
+	/// Map the existing file "path" read only. False if it can't be read or is empty
+	bool open(const std::string& path);
+	void close();
+	/// Let the pages go out of memory, they're read back from the file when used
+	void release();
+	void* data() const { return address; };
+	size_t size() const { return bytes; };
+
+private:
+	size_t bytes;
+	void* address;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif
+};
+
+class ColumnStore
+{
+public:
+	/// Not open, everything is allocated on the heap
+	ColumnStore() : budget(0), touched(0), opened(false) { };
+	~ColumnStore();
+	ColumnStore(const ColumnStore&) = delete;
+	ColumnStore& operator=(const ColumnStore&) = delete;
+
+	/// Use files in "folder", keeping at most "budget" bytes of them resident
+	void open(const std::string& folder, size_t budget);
+	bool isOpen() const { return opened; };
+	void* allocate(size_t size);
+	void deallocate(void* p);
+	/// Count "size" bytes of mapped memory as used. Releases all of it over the budget
+	void touch(size_t size);
+	void trim();
+
+	// Memory is brought in by pages of this size at least
+	static const size_t pageSize = 4096;
+
+private:
+	// Smaller blocks stay on the heap, a file each isn't worth it
+	static const size_t minimumMapped = 1 << 16;
+
+	std::string folder;
+	size_t budget;
+	std::atomic<size_t> touched;
+	bool opened;
+	std::mutex mutex;
+	std::map<void*, MappedFile*> files;
+};
+
+/******************************************************************************
+* MAPPED FILE IMPLEMENTATION
+******************************************************************************/
+/// New file of "size" bytes in "folder", deleted once it's closed
+bool MappedFile::create(const std::string& folder, size_t size)
+{
+	close();
+#ifdef _WIN32
+	char path[MAX_PATH];
+	if (GetTempFileNameA(folder.c_str(), "gog", 0, path) == 0) return false;
+	file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32),
+		(DWORD)(size & 0xFFFFFFFF), NULL);
+	if (mapping != NULL)
+		address = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (address == NULL)
+	{
+		close();
+		return false;
+	}
+#else
+	std::string path = folder + "/gogXXXXXX";
+	int fd = mkstemp(&path[0]);
+	if (fd < 0) return false;
+	// The file lives as long as the mapping
+	unlink(path.c_str());
+	if (ftruncate(fd, size) == 0)
+	{
+		address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED) address = NULL;
+	}
+	::close(fd);
+	if (address == NULL) return false;
+#endif
+	bytes = size;
+	return true;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+	size_t size = 0;
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		size = (size_t)fileSize.QuadPart;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL)
+			address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (address == NULL)
+	{
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+	{
+		size = info.st_size;
+		address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address == MAP_FAILED) address = NULL;
+		// It's read from the beginning to the end
+		else madvise(address, size, MADV_SEQUENTIAL);
+	}
+	::close(fd);
+	if (address == NULL) return false;
+#endif
+	bytes = size;
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (address != NULL) UnmapViewOfFile(address);
+	if (mapping != NULL) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (address != NULL) munmap(address, bytes);
+#endif
+	address = NULL;
+	bytes = 0;
+}
+
+void MappedFile::release()
+{
+	if (address == NULL) return;
+#ifdef _WIN32
+	// Unlocking pages that aren't locked takes them out of the working set
+	VirtualUnlock(address, bytes);
+#else
+	// Shared pages keep their content in the file
+	madvise(address, bytes, MADV_DONTNEED);
+#endif
+}
+
+/******************************************************************************
+* COLUMN STORE IMPLEMENTATION
+******************************************************************************/
+ColumnStore::~ColumnStore()
+{
+	for (std::map<void*, MappedFile*>::iterator it = files.begin(); it != files.end(); it++)
+		delete it->second;
+}
+
+void ColumnStore::open(const std::string& folder, size_t budget)
+{
+	this->folder = folder;
+	this->budget = budget;
+	opened = true;
+}
+
+/// A mapped file, or the heap when the block is small or the file can't be created
+void* ColumnStore::allocate(size_t size)
+{
+	if (opened && size >= minimumMapped)
+	{
+		MappedFile* file = new MappedFile();
+		if (file->create(folder, size))
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				files[file->data()] = file;
+			}
+			// It's about to be filled
+			touch(size);
+			return file->data();
+		}
+		delete file;
+		std::cout << "ERROR -> Failed to map " << size << " bytes in " << folder << ", using memory" << std::endl;
+	}
+	return ::operator new(size);
+}
+
+void ColumnStore::deallocate(void* p)
+{
+	MappedFile* file = NULL;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<void*, MappedFile*>::iterator it = files.find(p);
+		if (it != files.end())
+		{
+			file = it->second;
+			files.erase(it);
+		}
+	}
+	if (file != NULL)
+		delete file;
+	else
+		::operator delete(p);
+}
+
+void ColumnStore::touch(size_t size)
+{
+	if (!opened) return;
+	if ((touched += size) > budget)
+	{
+		touched = 0;
+		trim();
+	}
+}
+
+/// Release the pages of every file. Only the ones used again come back
+void ColumnStore::trim()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::map<void*, MappedFile*>::iterator it = files.begin(); it != files.end(); it++)
+		it->second->release();
+}
@@ -0,0 +1,385 @@
+/*
+* Globally optimal version of the tracker: successive shortest paths over the
+* min-cost flow network of the paper
+* Every detection "i" is split in an entry node u_i and an exit node v_i, joined by
+* an edge with the detection cost. The source links to every u_i (birth), every
+* v_i to the sink (death), and v_j to u_i for every neighbor j of i (transition).
+* Each shortest path adds one track and may reroute the ones found before, so
+* unlike DPTracking the tracks found are the best set for their amount
+*/
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#include "GOG.h"
+#include "IndexedHeap.h"
+#include "OriginIndex.h"
+
+class SSPTracking
+{
+public:
+	SSPTracking(const TrackingGraph& g, const GOGSettings& settings = GOGSettings())
+		: birthCost(settings.birthCost), deathCost(settings.deathCost),
+		transitionCost(settings.transitionCost), betta(settings.betta),
+		maxIterations(settings.maxIterations), maxTrackCost(settings.maxTrackCost),
+		graph(g) { };
+
+	void startTracking();
+	std::vector< std::vector<BoundingBox> > getBBoxes();
+	/// Detections kept after tracking, as indices of the graph detections
+	const std::vector<int>& getIndices() const { return indices; };
+	/// Track of every kept detection
+	const std::vector<int>& getIds() const { return ids; };
+	/// Cost added by every shortest path, in the order they were found
+	const std::vector<double>& getPathCosts() const { return pathCosts; };
+
+private:
+	void initDistances();
+	void augment();
+	void updateDistances();
+	void collectAffected(int root);
+	void seed(int node);
+	void relax(int from, int to, double cost);
+	void candidate(int from, int to, double cost);
+	void collectTracks();
+
+	// Node numbers of the network
+	int entry(int i) const { return 2 * i; };
+	int exit(int i) const { return 2 * i + 1; };
+	int source() const { return 2 * nDet; };
+	int sink() const { return 2 * nDet + 1; };
+
+	// Values of "pred" and "succ" that are not detections
+	enum { NONE = -1, SOURCE = -2, SINK = -3 };
+
+	int birthCost;
+	int deathCost;
+	int transitionCost;
+	double betta;
+	float maxIterations;
+	int maxTrackCost;
+
+	// Not owned, must outlive the tracker
+	const TrackingGraph& graph;
+	int nDet;
+	// Cost of every detection, same as "c" in DPTracking
+	std::vector<double> c;
+	// Detections of the next frame linked to each detection, in compressed rows
+	std::vector<int> succOffsets, succEdges;
+
+	// Flow: what comes before each detection in its track, what comes after it,
+	// and if it's part of a track at all
+	std::vector<int> pred, succ;
+	std::vector<char> used;
+
+	// Distance of every node from the source in the residual network, and the
+	// tree of shortest paths. The distances are the potentials that keep the
+	// reduced costs of the residual edges non-negative
+	std::vector<double> potential;
+	OriginIndex tree;
+	// Exits that can reach the sink, by "potential + deathCost"
+	IndexedHeap<double> deathHeap;
+
+	// Dijkstra over the nodes whose path from the source used the last track
+	std::vector<char> affected;
+	std::vector<int> affectedNodes;
+	std::vector<double> dist;
+	std::vector<int> parent;
+	std::vector< std::pair<double, int> > heap;
+
+	std::vector<double> pathCosts;
+	std::vector<int> indices;
+	std::vector<int> ids;
+};
+
+/******************************************************************************
+* MIN COST FLOW IMPLEMENTATION
+******************************************************************************/
+/// Add tracks while the cheapest one costs less than maxTrackCost
+void SSPTracking::startTracking()
+{
+	const Detections& dres = graph.getDres();
+	nDet = dres.x.size();
+	c.resize(nDet);
+	for (int i = 0; i < nDet; i++)
+		c[i] = betta - dres.score[i];
+
+	// The graph only knows the neighbors in the previous frame
+	succOffsets.assign(nDet + 1, 0);
+	for (int i = 0; i < nDet; i++)
+		for (int j : graph.getNei(i))
+			succOffsets[j + 1]++;
+	for (int i = 0; i < nDet; i++)
+		succOffsets[i + 1] += succOffsets[i];
+	succEdges.resize(succOffsets[nDet]);
+	std::vector<int> fill(succOffsets.begin(), succOffsets.end() - 1);
+	for (int i = 0; i < nDet; i++)
+		for (int j : graph.getNei(i))
+			succEdges[fill[j]++] = i;
+
+	pred.assign(nDet, NONE);
+	succ.assign(nDet, NONE);
+	used.assign(nDet, 0);
+	pathCosts.clear();
+	initDistances();
+
+	int it = 0;
+	// The shortest path to the sink is the next track, and never gets cheaper
+	while (it < maxIterations && potential[sink()] < maxTrackCost)
+	{
+		pathCosts.push_back(potential[sink()]);
+		augment();
+		updateDistances();
+		it++;
+	}
+	collectTracks();
+}
+
+/// Shortest paths from the source in the empty network. It's a DAG, since
+/// detections are sorted by frame and only linked to the previous one
+void SSPTracking::initDistances()
+{
+	int nodes = 2 * nDet + 2;
+	potential.assign(nodes, INFINITY);
+	tree.reset(nodes);
+	potential[source()] = 0;
+	for (int i = 0; i < nDet; i++)
+	{
+		int best = source();
+		potential[entry(i)] = birthCost;
+		for (int j : graph.getNei(i))
+		{
+			if (potential[exit(j)] + transitionCost < potential[entry(i)])
+			{
+				potential[entry(i)] = potential[exit(j)] + transitionCost;
+				best = exit(j);
+			}
+		}
+		tree.assign(entry(i), best);
+		potential[exit(i)] = potential[entry(i)] + c[i];
+		tree.assign(exit(i), entry(i));
+	}
+
+	std::vector<double> keys(nDet);
+	for (int i = 0; i < nDet; i++)
+		keys[i] = potential[exit(i)] + deathCost;
+	deathHeap.assign(keys);
+	if (nDet > 0)
+	{
+		potential[sink()] = deathHeap.topKey();
+		tree.assign(sink(), exit(deathHeap.top()));
+	}
+
+	affected.assign(nodes, 0);
+	dist.assign(nodes, INFINITY);
+	parent.assign(nodes, NONE);
+}
+
+/// Send one unit of flow through the shortest path, walking it back from the sink
+void SSPTracking::augment()
+{
+	int node = sink();
+	while (node != source())
+	{
+		int from = tree[node];
+		if (node == sink())
+			succ[from / 2] = SINK;
+		else if (from == source())
+			pred[node / 2] = SOURCE;
+		else if (from / 2 == node / 2)
+			used[node / 2] = (node == exit(node / 2)); // u_i -> v_i uses it, v_i -> u_i gives it back
+		else if (node == entry(node / 2))
+		{
+			// New transition v_j -> u_k
+			pred[node / 2] = from / 2;
+			succ[from / 2] = node / 2;
+		}
+		else
+		{
+			// Transition v_j -> u_k undone. The rest of the path sets the new links
+			if (pred[from / 2] == node / 2) pred[from / 2] = NONE;
+			if (succ[node / 2] == from / 2) succ[node / 2] = NONE;
+		}
+		node = from;
+	}
+}
+
+/// After an augmentation only the edges of the path changed (reversed), so only the
+/// nodes below it in the tree can be farther from the source. Their distances are
+/// found again with Dijkstra, starting from the edges that come from the rest of the tree
+void SSPTracking::updateDistances()
+{
+	// The path is a branch of the tree, all of it hangs from its first node
+	int first = sink();
+	while (tree[first] != source())
+		first = tree[first];
+	collectAffected(first);
+
+	for (int k = 0; k < affectedNodes.size(); k++)
+	{
+		int node = affectedNodes[k];
+		dist[node] = INFINITY;
+		parent[node] = NONE;
+		if (node != sink() && node == exit(node / 2))
+			deathHeap.update(node / 2, INFINITY);
+	}
+	heap.clear();
+	for (int k = 0; k < affectedNodes.size(); k++)
+		seed(affectedNodes[k]);
+	std::make_heap(heap.begin(), heap.end(), std::greater< std::pair<double, int> >());
+
+	while (!heap.empty())
+	{
+		std::pair<double, int> top = heap.front();
+		std::pop_heap(heap.begin(), heap.end(), std::greater< std::pair<double, int> >());
+		heap.pop_back();
+		int node = top.second;
+		if (top.first > dist[node]) continue; // Already reached through a shorter path
+
+		if (node == sink())
+		{
+			// Take the place of the last detection of a track
+			for (int k = 0; k < affectedNodes.size(); k++)
+			{
+				int v = affectedNodes[k];
+				if (v != sink() && v == exit(v / 2) && succ[v / 2] == SINK)
+					relax(node, v, -deathCost);
+			}
+			continue;
+		}
+		int i = node / 2;
+		if (node == entry(i))
+		{
+			if (!used[i]) relax(node, exit(i), c[i]);
+			// Take the place of the detection before it in its track
+			else if (pred[i] >= 0) relax(node, exit(pred[i]), -transitionCost);
+		}
+		else
+		{
+			// Give the detection back, its track is rerouted
+			if (used[i]) relax(node, entry(i), -c[i]);
+			if (succ[i] != SINK) relax(node, sink(), deathCost);
+			for (int k = succOffsets[i]; k < succOffsets[i + 1]; k++)
+				if (pred[succEdges[k]] != i)
+					relax(node, entry(succEdges[k]), transitionCost);
+		}
+	}
+
+	// Distances were found in reduced costs, relative to the old ones
+	for (int k = 0; k < affectedNodes.size(); k++)
+	{
+		int node = affectedNodes[k];
+		affected[node] = 0;
+		if (dist[node] == INFINITY)
+		{
+			// Only when the sink can't be reached anymore, which ends the tracking
+			potential[node] = INFINITY;
+			continue;
+		}
+		potential[node] += dist[node];
+		tree.assign(node, parent[node]);
+		if (node != sink() && node == exit(node / 2) && succ[node / 2] != SINK)
+			deathHeap.update(node / 2, potential[node] + deathCost);
+	}
+}
+
+/// Mark "root" and all the nodes below it in the tree
+void SSPTracking::collectAffected(int root)
+{
+	affectedNodes.clear();
+	affectedNodes.push_back(root);
+	affected[root] = 1;
+	std::vector<int> children;
+	for (int k = 0; k < affectedNodes.size(); k++)
+	{
+		tree.members(affectedNodes[k], children);
+		for (int m = 0; m < children.size(); m++)
+		{
+			if (children[m] == affectedNodes[k]) continue; // Roots are their own parent
+			affected[children[m]] = 1;
+			affectedNodes.push_back(children[m]);
+		}
+	}
+}
+
+/// First distance of an affected node, through the edges that come from nodes
+/// whose distance didn't change
+void SSPTracking::seed(int node)
+{
+	if (node == sink())
+	{
+		if (!deathHeap.empty() && deathHeap.topKey() < INFINITY)
+			candidate(exit(deathHeap.top()), node, deathCost);
+		return;
+	}
+	int i = node / 2;
+	if (node == entry(i))
+	{
+		if (pred[i] != SOURCE) candidate(source(), node, birthCost);
+		for (int j : graph.getNei(i))
+			if (pred[i] != j) candidate(exit(j), node, transitionCost);
+		if (used[i]) candidate(exit(i), node, -c[i]);
+	}
+	else
+	{
+		if (!used[i]) candidate(entry(i), node, c[i]);
+		if (succ[i] >= 0) candidate(entry(succ[i]), node, -transitionCost);
+		// Edges from the sink are always relaxed, since it's always affected
+	}
+	if (dist[node] < INFINITY)
+		heap.push_back(std::make_pair(dist[node], node));
+}
+
+/// Residual edge "from" -> "to" of real cost "cost", where "from" is not affected
+void SSPTracking::candidate(int from, int to, double cost)
+{
+	if (affected[from]) return;
+	double reduced = cost + potential[from] - potential[to];
+	if (reduced < 0) reduced = 0; // Rounding errors only
+	if (reduced < dist[to])
+	{
+		dist[to] = reduced;
+		parent[to] = from;
+	}
+}
+
+/// Residual edge "from" -> "to" of real cost "cost", between affected nodes
+void SSPTracking::relax(int from, int to, double cost)
+{
+	if (!affected[to]) return;
+	double reduced = cost + potential[from] - potential[to];
+	if (reduced < 0) reduced = 0; // Rounding errors only
+	double d = dist[from] + reduced;
+	if (d < dist[to])
+	{
+		dist[to] = d;
+		parent[to] = from;
+		heap.push_back(std::make_pair(d, to));
+		std::push_heap(heap.begin(), heap.end(), std::greater< std::pair<double, int> >());
+	}
+}
+
+/// Read the tracks from the flow. Tracks are numbered from 1 in the order they start
+void SSPTracking::collectTracks()
+{
+	indices.clear();
+	ids.clear();
+	int track = 0;
+	for (int i = 0; i < nDet; i++)
+	{
+		if (!used[i] || pred[i] != SOURCE) continue;
+		track++;
+		for (int d = i; d >= 0; d = succ[d])
+		{
+			indices.push_back(d);
+			ids.push_back(track);
+		}
+	}
+}
+
+std::vector< std::vector<BoundingBox> > SSPTracking::getBBoxes()
+{
+	return tracksToBoxes(graph.getDres(), indices, ids);
+}
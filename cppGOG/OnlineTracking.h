@@ -0,0 +1,150 @@
+/*
+* Online version of the GOG tracker
+* Detections are given frame by frame. The tracker keeps a sliding window of
+* the last frames, runs the DP over it, and finalizes each frame once it is
+* "latency" frames old. Track ids are kept across windows
+*/
+#pragma once
+#include <vector>
+#include <algorithm>
+
+#include "GOG.h"
+
+class OnlineTracking
+{
+public:
+	OnlineTracking(bool nmsOn, int windowSize, int latency, const GOGSettings& settings = GOGSettings());
+
+	int pushFrame(const Detections& frameDetections, std::vector<BoundingBox>& boxes);
+	int flush(std::vector<BoundingBox>& boxes);
+
+private:
+	void track();
+	int finalize(std::vector<BoundingBox>& boxes);
+
+	bool nmsInLoop;
+	// Amount of frames the DP runs over
+	int windowSize;
+	// Amount of frames a frame waits before being finalized
+	int latency;
+	GOGSettings settings;
+
+	// Last frame pushed, and last frame finalized. Frames are numbered from 1
+	int lastFrame;
+	int lastFinalized;
+	// Next id given to a new track
+	int nextId;
+
+	// Graph over the frames of the window, with the frame they were pushed in.
+	// Each frame only adds its own edges
+	TrackingGraph graph;
+	// Tracker of the window, reset on every run so its buffers are kept
+	DPTracking gog;
+	// Id given to every detection of the window when its frame was finalized. 0 if not given
+	std::vector<int> windowIds;
+	// Result of the last DP run: track of every detection of the window (0 if not kept),
+	// and id given to each track in the finalized frames
+	std::vector<int> windowTrack;
+	std::vector<int> trackIds;
+	// The window changed since the last DP run
+	bool dirty;
+};
+
+/******************************************************************************
+* ONLINE TRACKING IMPLEMENTATION
+******************************************************************************/
+/// "latency" must be smaller than "windowSize" - 1, so the window always keeps a
+/// finalized frame to take the track ids from
+OnlineTracking::OnlineTracking(bool nmsOn, int windowSize, int latency, const GOGSettings& settings)
+	: nmsInLoop(nmsOn), windowSize(MAX(windowSize, 2)), latency(latency), settings(settings),
+	lastFrame(0), lastFinalized(0), nextId(1), graph(MAX(windowSize, 2)), gog(nmsOn, graph, settings), dirty(false)
+{
+	if (this->latency > this->windowSize - 2) this->latency = this->windowSize - 2;
+	if (this->latency < 0) this->latency = 0;
+}
+
+/// Add the detections of the next frame (their frame number is not used). When a frame
+/// becomes final, its boxes are written in "boxes" and its number returned. Otherwise returns 0
+int OnlineTracking::pushFrame(const Detections& frameDetections, std::vector<BoundingBox>& boxes)
+{
+	lastFrame++;
+	// The graph forgets the frames that left the window
+	int old = graph.appendFrame(frameDetections, lastFrame);
+	windowIds.resize(windowIds.size() + frameDetections.x.size(), 0);
+	windowIds.erase(windowIds.begin(), windowIds.begin() + old);
+	dirty = true;
+
+	if (lastFrame - latency <= lastFinalized)
+	{
+		boxes.clear();
+		return 0;
+	}
+	return finalize(boxes);
+}
+
+/// At the end of the stream, finalize the next frame still waiting. Returns 0 when there are none
+int OnlineTracking::flush(std::vector<BoundingBox>& boxes)
+{
+	boxes.clear();
+	if (lastFinalized >= lastFrame) return 0;
+	return finalize(boxes);
+}
+
+/// Run the DP over the detections of the window
+void OnlineTracking::track()
+{
+	int nDet = graph.size();
+	windowTrack.assign(nDet, 0);
+	trackIds.clear();
+	dirty = false;
+	if (nDet == 0) return;
+
+	gog.reset(graph);
+	gog.startTracking();
+	const std::vector<int>& kept = gog.getIndices();
+	const std::vector<int>& tracks = gog.getIds();
+	for (int i = 0; i < kept.size(); i++)
+		windowTrack[kept[i]] = tracks[i];
+
+	// Tracks come out from the best to the worst. Each takes the id of its detection
+	// in the most recent finalized frame, unless a better track already took it
+	int nTracks = tracks.empty() ? 0 : *std::max_element(tracks.begin(), tracks.end());
+	std::vector<int> latest(nTracks + 1, -1);
+	for (int i = 0; i < nDet; i++)
+		if (windowTrack[i] != 0 && windowIds[i] != 0)
+			latest[windowTrack[i]] = i; // Detections are sorted by frame
+	trackIds.assign(nTracks + 1, 0);
+	std::vector<int> taken;
+	for (int t = 1; t <= nTracks; t++)
+	{
+		if (latest[t] < 0) continue;
+		int id = windowIds[latest[t]];
+		if (std::find(taken.begin(), taken.end(), id) != taken.end()) continue;
+		trackIds[t] = id;
+		taken.push_back(id);
+	}
+}
+
+/// Give the boxes of the oldest frame not finalized yet, with their track ids
+int OnlineTracking::finalize(std::vector<BoundingBox>& boxes)
+{
+	if (dirty) track();
+	int frame = ++lastFinalized;
+	boxes.clear();
+
+	const Detections& window = graph.getDres();
+	for (int i = window.frameBegin(frame); i < window.frameEnd(frame); i++)
+	{
+		int t = windowTrack[i];
+		if (t == 0) continue;
+		// First box of a track that had no id yet
+		if (trackIds[t] == 0) trackIds[t] = nextId++;
+		windowIds[i] = trackIds[t];
+		BoundingBox b = { window.x[i], window.y[i], window.w[i], window.h[i], trackIds[t] };
+		boxes.push_back(b);
+	}
+	// Same order as the offline tracker output
+	std::sort(boxes.begin(), boxes.end(),
+		[](const BoundingBox& a, const BoundingBox& b) { return a.id < b.id; });
+	return frame;
+}
@@ -0,0 +1,70 @@
+/*
+* Origin of every node of the DP ("orig" in the matlab implementation), with the
+* inverted index from each origin to the nodes that have it
+* Members of an origin are kept in a doubly linked list, so changing the origin
+* of a node costs O(1) and listing the members of an origin costs O(members)
+*/
+#pragma once
+#include <vector>
+#include <algorithm>
+
+class OriginIndex
+{
+public:
+	void reset(int n);
+	void assign(int node, int newOrigin);
+	void members(int o, std::vector<int>& out) const;
+
+	/// Origin of "node"
+	int operator[](int node) const { return origin[node]; };
+
+private:
+	std::vector<int> origin;
+	// First member of every origin, and links between the members of the same origin. -1 ends a list
+	std::vector<int> head;
+	std::vector<int> next;
+	std::vector<int> prev;
+};
+
+/******************************************************************************
+* ORIGIN INDEX IMPLEMENTATION
+******************************************************************************/
+/// Nodes 0 to n-1, each one being its own origin
+void OriginIndex::reset(int n)
+{
+	origin.resize(n);
+	head.resize(n);
+	next.assign(n, -1);
+	prev.assign(n, -1);
+	for (int i = 0; i < n; i++)
+	{
+		origin[i] = i;
+		head[i] = i;
+	}
+}
+
+/// Same as "orig[node] = newOrigin", moving the node to the list of its new origin
+void OriginIndex::assign(int node, int newOrigin)
+{
+	int o = origin[node];
+	if (o == newOrigin) return;
+	// Unlink from the old list
+	if (prev[node] != -1) next[prev[node]] = next[node];
+	else head[o] = next[node];
+	if (next[node] != -1) prev[next[node]] = prev[node];
+	// Link at the front of the new one
+	prev[node] = -1;
+	next[node] = head[newOrigin];
+	if (head[newOrigin] != -1) prev[head[newOrigin]] = node;
+	head[newOrigin] = node;
+	origin[node] = newOrigin;
+}
+
+/// Same as "find(orig == o)": the nodes with origin "o", in ascending order
+void OriginIndex::members(int o, std::vector<int>& out) const
+{
+	out.clear();
+	for (int node = head[o]; node != -1; node = next[node])
+		out.push_back(node);
+	std::sort(out.begin(), out.end());
+}
@@ -0,0 +1,143 @@
+/*
+* Overlap of one box against many boxes stored as separate x/y/w/h arrays
+* Uses AVX or SSE depending on the processor, with a scalar fallback
+*/
+#pragma once
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GOG_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only generate AVX instructions in functions marked for it
+#if defined(__GNUC__) || defined(__clang__)
+#define GOG_TARGET_AVX __attribute__((target("avx")))
+#else
+#define GOG_TARGET_AVX
+#endif
+
+/// Computes, for every box "k" of the span, the IoU and the intersection over the area
+/// of the first box. Boxes of the span are (x[k], y[k], x[k] + w[k], y[k] + h[k])
+typedef void(*OverlapKernel)(float minx1, float miny1, float maxx1, float maxy1,
+	const float* x, const float* y, const float* w, const float* h, int count, float* iou, float* ioa);
+
+/// Plain version, used for the boxes that don't fill a whole SIMD register
+inline void overlapScalar(float minx1, float miny1, float maxx1, float maxy1,
+	const float* x, const float* y, const float* w, const float* h, int count, float* iou, float* ioa)
+{
+	float area1 = (maxx1 - minx1)*(maxy1 - miny1);
+	for (int k = 0; k < count; k++)
+	{
+		float minx2 = x[k], miny2 = y[k], maxx2 = x[k] + w[k], maxy2 = y[k] + h[k];
+		if (minx1 > maxx2 || maxx1 < minx2 || miny1 > maxy2 || maxy1 < miny2)
+		{
+			iou[k] = 0.0f;
+			ioa[k] = 0.0f;
+			continue;
+		}
+		float dx = (maxx2 < maxx1 ? maxx2 : maxx1) - (minx2 > minx1 ? minx2 : minx1);
+		float dy = (maxy2 < maxy1 ? maxy2 : maxy1) - (miny2 > miny1 ? miny2 : miny1);
+		float area2 = (maxx2 - minx2)*(maxy2 - miny2);
+		float inter = dx*dy; // Intersection
+		float uni = area1 + area2 - inter; // Union
+		iou[k] = inter / uni;
+		ioa[k] = inter / area1;
+	}
+}
+
+#if GOG_X86
+/// 4 boxes at a time. SSE is always present on the processors we build for
+inline void overlapSSE(float minx1, float miny1, float maxx1, float maxy1,
+	const float* x, const float* y, const float* w, const float* h, int count, float* iou, float* ioa)
+{
+	float area1s = (maxx1 - minx1)*(maxy1 - miny1);
+	__m128 bminx = _mm_set1_ps(minx1), bminy = _mm_set1_ps(miny1);
+	__m128 bmaxx = _mm_set1_ps(maxx1), bmaxy = _mm_set1_ps(maxy1);
+	__m128 area1 = _mm_set1_ps(area1s);
+	int k = 0;
+	for (; k + 4 <= count; k += 4)
+	{
+		__m128 minx2 = _mm_loadu_ps(x + k), miny2 = _mm_loadu_ps(y + k);
+		__m128 maxx2 = _mm_add_ps(minx2, _mm_loadu_ps(w + k));
+		__m128 maxy2 = _mm_add_ps(miny2, _mm_loadu_ps(h + k));
+		// Boxes that don't touch have no overlap at all
+		__m128 apart = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(bminx, maxx2), _mm_cmplt_ps(bmaxx, minx2)),
+			_mm_or_ps(_mm_cmpgt_ps(bminy, maxy2), _mm_cmplt_ps(bmaxy, miny2)));
+		__m128 dx = _mm_sub_ps(_mm_min_ps(maxx2, bmaxx), _mm_max_ps(minx2, bminx));
+		__m128 dy = _mm_sub_ps(_mm_min_ps(maxy2, bmaxy), _mm_max_ps(miny2, bminy));
+		__m128 area2 = _mm_mul_ps(_mm_sub_ps(maxx2, minx2), _mm_sub_ps(maxy2, miny2));
+		__m128 inter = _mm_mul_ps(dx, dy);
+		__m128 uni = _mm_sub_ps(_mm_add_ps(area1, area2), inter);
+		_mm_storeu_ps(iou + k, _mm_andnot_ps(apart, _mm_div_ps(inter, uni)));
+		_mm_storeu_ps(ioa + k, _mm_andnot_ps(apart, _mm_div_ps(inter, area1)));
+	}
+	overlapScalar(minx1, miny1, maxx1, maxy1, x + k, y + k, w + k, h + k, count - k, iou + k, ioa + k);
+}
+
+/// 8 boxes at a time
+GOG_TARGET_AVX inline void overlapAVX(float minx1, float miny1, float maxx1, float maxy1,
+	const float* x, const float* y, const float* w, const float* h, int count, float* iou, float* ioa)
+{
+	float area1s = (maxx1 - minx1)*(maxy1 - miny1);
+	__m256 bminx = _mm256_set1_ps(minx1), bminy = _mm256_set1_ps(miny1);
+	__m256 bmaxx = _mm256_set1_ps(maxx1), bmaxy = _mm256_set1_ps(maxy1);
+	__m256 area1 = _mm256_set1_ps(area1s);
+	int k = 0;
+	for (; k + 8 <= count; k += 8)
+	{
+		__m256 minx2 = _mm256_loadu_ps(x + k), miny2 = _mm256_loadu_ps(y + k);
+		__m256 maxx2 = _mm256_add_ps(minx2, _mm256_loadu_ps(w + k));
+		__m256 maxy2 = _mm256_add_ps(miny2, _mm256_loadu_ps(h + k));
+		// Boxes that don't touch have no overlap at all
+		__m256 apart = _mm256_or_ps(
+			_mm256_or_ps(_mm256_cmp_ps(bminx, maxx2, _CMP_GT_OQ), _mm256_cmp_ps(bmaxx, minx2, _CMP_LT_OQ)),
+			_mm256_or_ps(_mm256_cmp_ps(bminy, maxy2, _CMP_GT_OQ), _mm256_cmp_ps(bmaxy, miny2, _CMP_LT_OQ)));
+		__m256 dx = _mm256_sub_ps(_mm256_min_ps(maxx2, bmaxx), _mm256_max_ps(minx2, bminx));
+		__m256 dy = _mm256_sub_ps(_mm256_min_ps(maxy2, bmaxy), _mm256_max_ps(miny2, bminy));
+		__m256 area2 = _mm256_mul_ps(_mm256_sub_ps(maxx2, minx2), _mm256_sub_ps(maxy2, miny2));
+		__m256 inter = _mm256_mul_ps(dx, dy);
+		__m256 uni = _mm256_sub_ps(_mm256_add_ps(area1, area2), inter);
+		_mm256_storeu_ps(iou + k, _mm256_andnot_ps(apart, _mm256_div_ps(inter, uni)));
+		_mm256_storeu_ps(ioa + k, _mm256_andnot_ps(apart, _mm256_div_ps(inter, area1)));
+	}
+	overlapSSE(minx1, miny1, maxx1, maxy1, x + k, y + k, w + k, h + k, count - k, iou + k, ioa + k);
+}
+
+/// True when both the processor and the OS support AVX
+inline bool cpuHasAVX()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("avx");
+#endif
+}
+#endif // GOG_X86
+
+/// Choose the best kernel for this processor
+inline OverlapKernel selectOverlapKernel()
+{
+#if GOG_X86
+	if (cpuHasAVX()) return overlapAVX;
+	return overlapSSE;
+#else
+	return overlapScalar;
+#endif
+}
+
+/// Overlap of the box (minx1, miny1, maxx1, maxy1) against the "count" boxes of the span.
+/// Gives the same values as intersectionOverUnion for every pair
+inline void overlapOneToMany(float minx1, float miny1, float maxx1, float maxy1,
+	const float* x, const float* y, const float* w, const float* h, int count, float* iou, float* ioa)
+{
+	static const OverlapKernel kernel = selectOverlapKernel();
+	kernel(minx1, miny1, maxx1, maxy1, x, y, w, h, count, iou, ioa);
+}
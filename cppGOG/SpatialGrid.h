@@ -0,0 +1,150 @@
+/*
+* Uniform grid over the boxes of a single frame
+* Used to find which boxes may overlap a given box without testing all of them
+*/
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+class SpatialGrid
+{
+public:
+	SpatialGrid() : cols(0), rows(0), first(0), currentStamp(0) { };
+
+	bool build(const float* x, const float* y, const float* w, const float* h, int begin, int end);
+	void query(float minx, float miny, float maxx, float maxy, std::vector<int>& candidates);
+
+private:
+	int cellColumn(float v) const;
+	int cellRow(float v) const;
+
+	// Top left corner of the indexed area
+	float originX, originY;
+	// Size of each cell
+	float cellW, cellH;
+	int cols, rows;
+	// Index of the first indexed box. Boxes are stored relative to it
+	int first;
+	// Boxes of each cell, stored contiguously. Cell "i" owns [cellStart[i], cellStart[i+1])
+	std::vector<int> cellStart;
+	std::vector<int> cellBoxes;
+	std::vector<int> cellFill;
+	// Range of cells covered by every box (column min/max, row min/max)
+	std::vector<int> boxCells;
+	// Used to report each box only once per query
+	std::vector<int> stamp;
+	int currentStamp;
+};
+
+/******************************************************************************
+* SPATIAL GRID IMPLEMENTATION
+******************************************************************************/
+/// Index the boxes [begin, end). Returns false when the boxes can't be
+/// placed on a grid (non-finite coordinates), the caller should then test all of them
+bool SpatialGrid::build(const float* x, const float* y, const float* w, const float* h, int begin, int end)
+{
+	int n = end - begin;
+	first = begin;
+	cols = rows = 1;
+	cellStart.assign(2, 0);
+	cellBoxes.clear();
+	boxCells.resize(4 * n);
+	stamp.assign(n, currentStamp);
+	if (n <= 0) return true;
+
+	// Extent of all the boxes, and their mean size to choose the cell size.
+	// Negative sizes are allowed, so every box is normalized to (min, max) first
+	float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+	double sumW = 0, sumH = 0;
+	for (int i = begin; i < end; i++)
+	{
+		float x2 = x[i] + w[i], y2 = y[i] + h[i];
+		if (!std::isfinite(x[i]) || !std::isfinite(y[i]) || !std::isfinite(x2) || !std::isfinite(y2))
+			return false;
+		minX = MIN(minX, MIN(x[i], x2)); maxX = MAX(maxX, MAX(x[i], x2));
+		minY = MIN(minY, MIN(y[i], y2)); maxY = MAX(maxY, MAX(y[i], y2));
+		sumW += std::fabs(w[i]);
+		sumH += std::fabs(h[i]);
+	}
+
+	// Cells about the size of an average box, so each box covers a few of them.
+	// The amount of cells is kept in the order of the amount of boxes
+	int maxCells = MAX(1, (int)(2 * std::sqrt((double)n)));
+	float spanX = maxX - minX, spanY = maxY - minY;
+	float meanW = (float)(sumW / n), meanH = (float)(sumH / n);
+	if (spanX > 0 && meanW > 0) cols = (int)MIN((double)maxCells, std::ceil(spanX / meanW));
+	if (spanY > 0 && meanH > 0) rows = (int)MIN((double)maxCells, std::ceil(spanY / meanH));
+	cols = MAX(cols, 1); rows = MAX(rows, 1);
+	originX = minX; originY = minY;
+	cellW = spanX > 0 ? spanX / cols : 1.0f;
+	cellH = spanY > 0 ? spanY / rows : 1.0f;
+
+	// Counting sort of the boxes into the cells they cover
+	cellStart.assign(cols * rows + 1, 0);
+	for (int i = begin; i < end; i++)
+	{
+		int* cells = &boxCells[4 * (i - begin)];
+		cells[0] = cellColumn(MIN(x[i], x[i] + w[i]));
+		cells[1] = cellColumn(MAX(x[i], x[i] + w[i]));
+		cells[2] = cellRow(MIN(y[i], y[i] + h[i]));
+		cells[3] = cellRow(MAX(y[i], y[i] + h[i]));
+		for (int r = cells[2]; r <= cells[3]; r++)
+			for (int c = cells[0]; c <= cells[1]; c++)
+				cellStart[r * cols + c + 1]++;
+	}
+	for (int i = 0; i < cols * rows; i++)
+		cellStart[i + 1] += cellStart[i];
+	cellBoxes.resize(cellStart.back());
+	cellFill.assign(cellStart.begin(), cellStart.end() - 1);
+	for (int i = 0; i < n; i++)
+	{
+		const int* cells = &boxCells[4 * i];
+		for (int r = cells[2]; r <= cells[3]; r++)
+			for (int c = cells[0]; c <= cells[1]; c++)
+				cellBoxes[cellFill[r * cols + c]++] = i;
+	}
+	return true;
+}
+
+/// Appends to "candidates" the indices of all the indexed boxes sharing a cell with
+/// the given extent, in ascending order. Every box that overlaps the extent is reported
+void SpatialGrid::query(float minx, float miny, float maxx, float maxy, std::vector<int>& candidates)
+{
+	candidates.clear();
+	if (cellBoxes.empty()) return;
+	int c0 = cellColumn(MIN(minx, maxx)), c1 = cellColumn(MAX(minx, maxx));
+	int r0 = cellRow(MIN(miny, maxy)), r1 = cellRow(MAX(miny, maxy));
+
+	currentStamp++;
+	for (int r = r0; r <= r1; r++)
+		for (int c = c0; c <= c1; c++)
+			for (int k = cellStart[r * cols + c]; k < cellStart[r * cols + c + 1]; k++)
+			{
+				int box = cellBoxes[k];
+				if (stamp[box] == currentStamp) continue;
+				stamp[box] = currentStamp;
+				candidates.push_back(first + box);
+			}
+	// Boxes are already sorted when only one cell is visited
+	if (r0 != r1 || c0 != c1)
+		std::sort(candidates.begin(), candidates.end());
+}
+
+/// Column of the cell containing "v", clamped to the grid
+int SpatialGrid::cellColumn(float v) const
+{
+	float c = (v - originX) / cellW;
+	if (!(c > 0)) return 0;
+	if (c >= cols) return cols - 1;
+	return (int)c;
+}
+
+/// Row of the cell containing "v", clamped to the grid
+int SpatialGrid::cellRow(float v) const
+{
+	float r = (v - originY) / cellH;
+	if (!(r > 0)) return 0;
+	if (r >= rows) return rows - 1;
+	return (int)r;
+}
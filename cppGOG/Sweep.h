@@ -0,0 +1,121 @@
+/*
+* Sweep of the tracker settings over a grid of values
+* The graph only depends on the detections, so it's built once and shared,
+* read only, by one DPTracking per combination of the grid, run on the pool.
+* Every combination writes its own results, "<sequence>_<k>_LX.txt"..., and
+* "<sequence>_sweep.txt" lists the settings of every k
+*/
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "GOG.h"
+#include "ThreadPool.h"
+#include "UA-DETRAC.h"
+
+namespace Sweep
+{
+	/// Values tried for every setting. Each one starts with the default
+	struct Grid
+	{
+		std::vector<int> birthCost;
+		std::vector<int> deathCost;
+		std::vector<int> transitionCost;
+		std::vector<double> betta;
+		std::vector<int> maxTrackCost;
+		std::vector<double> nmsThreshold;
+
+		Grid()
+		{
+			GOGSettings settings;
+			birthCost.push_back(settings.birthCost);
+			deathCost.push_back(settings.deathCost);
+			transitionCost.push_back(settings.transitionCost);
+			betta.push_back(settings.betta);
+			maxTrackCost.push_back(settings.maxTrackCost);
+			nmsThreshold.push_back(settings.nmsThreshold);
+		}
+	};
+
+	/// Comma separated values, "1,2,3"
+	template <class T>
+	void read_values(const std::string& list, std::vector<T>& values)
+	{
+		values.clear();
+		std::stringstream stream(list);
+		std::string value;
+		while (std::getline(stream, value, ','))
+			if (!value.empty()) values.push_back((T)atof(value.c_str()));
+	}
+
+	/// Read a "name=values" argument into the grid, where name is one of
+	/// birth, death, transition, betta, thr or nms. Returns false if it's not one of them
+	bool read_argument(const std::string& argument, Grid& grid)
+	{
+		size_t equal = argument.find('=');
+		if (equal == std::string::npos) return false;
+		std::string name = argument.substr(0, equal), list = argument.substr(equal + 1);
+		if (name == "birth") read_values(list, grid.birthCost);
+		else if (name == "death") read_values(list, grid.deathCost);
+		else if (name == "transition") read_values(list, grid.transitionCost);
+		else if (name == "betta") read_values(list, grid.betta);
+		else if (name == "thr") read_values(list, grid.maxTrackCost);
+		else if (name == "nms") read_values(list, grid.nmsThreshold);
+		else return false;
+		return true;
+	}
+
+	/// Every combination of the values of the grid
+	std::vector<GOGSettings> combinations(const Grid& grid)
+	{
+		std::vector<GOGSettings> all;
+		for (int b : grid.birthCost)
+			for (int d : grid.deathCost)
+				for (int t : grid.transitionCost)
+					for (double be : grid.betta)
+						for (int c : grid.maxTrackCost)
+							for (double n : grid.nmsThreshold)
+							{
+								GOGSettings settings;
+								settings.birthCost = b;
+								settings.deathCost = d;
+								settings.transitionCost = t;
+								settings.betta = be;
+								settings.maxTrackCost = c;
+								settings.nmsThreshold = n;
+								all.push_back(settings);
+							}
+		return all;
+	}
+
+	/// Track the graph with every settings on the pool, writing the results of each one
+	/// as soon as it's done. Only the amount of boxes and tracks of every one is kept
+	void run(const TrackingGraph& graph, const std::vector<GOGSettings>& all, bool nms, ThreadPool& pool,
+		std::string& output_folder, std::string& sequence)
+	{
+		std::vector<int> boxes(all.size(), 0), tracks(all.size(), 0);
+		pool.parallelFor(all.size(), [&](int k)
+		{
+			DPTracking gog(nms, graph, all[k]);
+			gog.startTracking();
+			boxes[k] = gog.getIndices().size();
+			tracks[k] = gog.getIds().empty() ? 0 : gog.getIds().back();
+			std::vector< std::vector<BoundingBox> > bboxes = gog.getBBoxes();
+			std::string name = sequence + "_" + std::to_string(k);
+			if (!bboxes.empty())
+				UADETRAC::write_results(output_folder, name, bboxes, true);
+		});
+
+		std::ofstream index(output_folder + "/" + sequence + "_sweep.txt");
+		index << "k,birth,death,transition,betta,thr,nms,boxes,tracks" << std::endl;
+		for (int k = 0; k < all.size(); k++)
+			index << k << "," << all[k].birthCost << "," << all[k].deathCost << "," << all[k].transitionCost
+				<< "," << all[k].betta << "," << all[k].maxTrackCost << "," << all[k].nmsThreshold
+				<< "," << boxes[k] << "," << tracks[k] << std::endl;
+	}
+
+} // end of namespace
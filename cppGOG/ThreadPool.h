@@ -0,0 +1,128 @@
+/*
+* Fixed size pool of worker threads
+* Work is given as loops, where the calling thread also takes part. A loop
+* started from inside another loop never waits for a free worker, so loops
+* can be nested without blocking the pool
+*/
+#pragma once
+#include <vector>
+#include <queue>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+class ThreadPool
+{
+public:
+	ThreadPool(int threads = 0);
+	~ThreadPool();
+
+	/// Amount of threads working on a loop, including the calling one
+	int size() const { return workers.size() + 1; };
+	template <class F> void parallelFor(int count, F body);
+
+private:
+	void work();
+
+	std::vector<std::thread> workers;
+	std::queue< std::function<void()> > tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping;
+};
+
+/******************************************************************************
+* THREAD POOL IMPLEMENTATION
+******************************************************************************/
+/// Use "threads" threads in total. 0 or less means one per hardware thread
+ThreadPool::ThreadPool(int threads) : stopping(false)
+{
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	// The thread calling parallelFor is one of them
+	for (int i = 1; i < threads; i++)
+		workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+/// Loop of every worker, runs the queued tasks until the pool is destroyed
+void ThreadPool::work()
+{
+	std::function<void()> task;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty()) return;
+			task = tasks.front();
+			tasks.pop();
+		}
+		task();
+	}
+}
+
+/// Run body(i) for every i in [0, count), spread over the threads of the pool.
+/// Returns once all of them finished. The order of the calls is not defined
+template <class F>
+void ThreadPool::parallelFor(int count, F body)
+{
+	if (count <= 0) return;
+
+	// Shared with the workers, which may start after this call returned
+	struct Loop
+	{
+		std::atomic<int> next;
+		std::atomic<int> done;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+	loop->next = 0;
+	loop->done = 0;
+
+	// Body is only used while there are indices left, so it's alive whenever it's called
+	F* f = &body;
+	std::function<void()> run = [loop, f, count]()
+	{
+		int i;
+		while ((i = loop->next++) < count)
+		{
+			(*f)(i);
+			if (++loop->done == count)
+			{
+				std::lock_guard<std::mutex> lock(loop->mutex);
+				loop->finished.notify_all();
+			}
+		}
+	};
+
+	int helpers = workers.size() < count - 1 ? workers.size() : count - 1;
+	if (helpers > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (int i = 0; i < helpers; i++)
+				tasks.push(run);
+		}
+		condition.notify_all();
+	}
+	// Take part instead of waiting. If all the workers are busy, everything is done here
+	run();
+
+	std::unique_lock<std::mutex> lock(loop->mutex);
+	loop->finished.wait(lock, [&loop, count] { return loop->done == count; });
+}
@@ -0,0 +1,128 @@
+/*
+* Every track found by a DPTracking run, in the order it found them
+* The DP only looks at maxTrackCost and maxIterations to stop, so the result of
+* any tighter values is the beginning of a looser run: the tracks up to the
+* first one over maxTrackCost, and no more than maxIterations of them
+*/
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "CSV.h"
+#include "GOG.h"
+
+class Trajectory
+{
+public:
+	Trajectory() : recordedCost(0), recordedIterations(0), exhausted(false) { };
+	/// Tracks of a finished run, with the settings it used
+	Trajectory(const DPTracking& gog, const GOGSettings& settings);
+
+	/// True if the result of these values is in the trajectory
+	bool covers(int maxTrackCost, float maxIterations) const;
+	/// Result the DP gives with these values, as indices and ids like DPTracking
+	void select(int maxTrackCost, float maxIterations, std::vector<int>& indices, std::vector<int>& ids) const;
+	/// Amount of tracks recorded
+	int size() const { return costs.size(); };
+	const std::vector<float>& getTrackCosts() const { return costs; };
+
+	bool save(const std::string& filename) const;
+	bool load(const std::string& filename);
+
+private:
+	// Detections of every track, track "t" from trackStart[t] to trackStart[t + 1] - 1
+	std::vector<int> indices;
+	std::vector<int> trackStart;
+	std::vector<float> costs;
+	// Settings of the run. If it ran out of tracks before them, any value is covered
+	int recordedCost;
+	float recordedIterations;
+	bool exhausted;
+};
+
+/******************************************************************************
+* TRAJECTORY IMPLEMENTATION
+******************************************************************************/
+Trajectory::Trajectory(const DPTracking& gog, const GOGSettings& settings)
+	: indices(gog.getIndices()), costs(gog.getTrackCosts()),
+	recordedCost(settings.maxTrackCost), recordedIterations(settings.maxIterations)
+{
+	// Ids are the iteration that found the track, so every track is contiguous
+	const std::vector<int>& ids = gog.getIds();
+	for (int i = 0; i < ids.size(); i++)
+		if (i == 0 || ids[i] != ids[i - 1])
+			trackStart.push_back(i);
+	trackStart.push_back(indices.size());
+	// Stopped before both limits: nothing was left to track
+	exhausted = (costs.empty() || costs.back() < recordedCost) && costs.size() < recordedIterations;
+}
+
+bool Trajectory::covers(int maxTrackCost, float maxIterations) const
+{
+	if (exhausted || maxIterations <= costs.size()) return true;
+	// It stops at the first track over the cost
+	for (int t = 0; t < costs.size(); t++)
+		if (costs[t] >= maxTrackCost) return true;
+	return false;
+}
+
+/// Same stop rule as DPTracking::startTracking: the last track taken is the first one
+/// over "maxTrackCost"
+void Trajectory::select(int maxTrackCost, float maxIterations, std::vector<int>& indices,
+	std::vector<int>& ids) const
+{
+	indices.clear();
+	ids.clear();
+	for (int t = 0; t < costs.size() && t < maxIterations; t++)
+	{
+		if (t > 0 && costs[t - 1] >= maxTrackCost) break;
+		indices.insert(indices.end(), this->indices.begin() + trackStart[t], this->indices.begin() + trackStart[t + 1]);
+		ids.insert(ids.end(), trackStart[t + 1] - trackStart[t], t + 1);
+	}
+}
+
+/// Text file: "maxTrackCost,maxIterations,exhausted" then one track per line, "cost,detections..."
+bool Trajectory::save(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file) return false;
+	// Enough digits to read back the same float
+	file << std::setprecision(9);
+	file << recordedCost << "," << recordedIterations << "," << exhausted << std::endl;
+	for (int t = 0; t < costs.size(); t++)
+	{
+		file << costs[t];
+		for (int i = trackStart[t]; i < trackStart[t + 1]; i++)
+			file << "," << indices[i];
+		file << std::endl;
+	}
+	return true;
+}
+
+bool Trajectory::load(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file || file.eof()) return false;
+	indices.clear();
+	trackStart.assign(1, 0);
+	costs.clear();
+
+	CSVIterator loop(file);
+	if (loop == CSVIterator() || (*loop).size() < 3) return false;
+	recordedCost = atoi((*loop)[0].c_str());
+	recordedIterations = (float)atof((*loop)[1].c_str());
+	exhausted = atoi((*loop)[2].c_str()) != 0;
+	for (++loop; loop != CSVIterator(); ++loop)
+	{
+		if ((*loop).size() < 2) continue;
+		costs.push_back((float)atof((*loop)[0].c_str()));
+		for (int i = 1; i < (*loop).size(); i++)
+			indices.push_back(atoi((*loop)[i].c_str()));
+		trackStart.push_back(indices.size());
+	}
+	return true;
+}
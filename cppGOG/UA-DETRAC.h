@@ -10,9 +10,13 @@
 #include <cstdio>
 #include <string>
 #include <iomanip>
+#include <cmath>
+#include <thread>
 
 #include "CSV.h"
 #include "GOG.h"
+#include "MappedCSV.h"
+#include "ThreadPool.h"
 
 namespace UADETRAC
 {
@@ -31,90 +35,243 @@ namespace UADETRAC
 			// UA-DETRAC made a little change on the score
 			detections.score.push_back(std::stof((*loop)[6]) * 3 - 1.5);
 		}
+		// Frames are read in order, so each one can be found directly
+		detections.indexFrames();
 	}
 
-	/// To output only up to 2 decimals
-	std::string to_string_with_precision(float value)
+	/// Lines of a mapped file on a Detections struct, without indexing the frames
+	void read_lines(MappedCSV& file, Detections& detections)
 	{
-		int decimals = 0;
-		if (value != 0)
-			decimals = 2;
+		while (file.next())
+		{
+			if (file.size() < 7) continue;
+			detections.frame.push_back(file.toInt(0));
+			detections.x.push_back(file.toFloat(2));
+			detections.y.push_back(file.toFloat(3));
+			detections.w.push_back(file.toFloat(4));
+			detections.h.push_back(file.toFloat(5));
+			// UA-DETRAC made a little change on the score
+			detections.score.push_back(file.toFloat(6) * 3 - 1.5);
+		}
+	}
+
+	/// Same as read_detections, reading the file in place. False if it can't be read or is empty
+	bool read_detections(const std::string& filename, Detections& detections)
+	{
+		MappedCSV file;
+		if (!file.open(filename)) return false;
+		detections.reserve(detections.x.size() + file.countLines());
+		read_lines(file, detections);
+		detections.indexFrames();
+		return true;
+	}
+
+	/// Same as read_detections, every thread of "pool" reading a part of the file
+	bool read_detections(const std::string& filename, Detections& detections, ThreadPool& pool)
+	{
+		MappedCSV file;
+		if (!file.open(filename)) return false;
+		std::vector<size_t> bounds;
+		file.split(pool.size(), bounds);
+		// Parts are kept in the same store as the result
+		std::vector<Detections> parts(bounds.size() - 1, Detections(detections.x.get_allocator().store));
+		pool.parallelFor(parts.size(), [&](int p)
+		{
+			MappedCSV part(file, bounds[p], bounds[p + 1]);
+			parts[p].reserve(part.countLines());
+			read_lines(part, parts[p]);
+		});
+		size_t total = detections.x.size();
+		for (int p = 0; p < parts.size(); p++)
+			total += parts[p].x.size();
+		detections.reserve(total);
+		for (int p = 0; p < parts.size(); p++)
+			detections.append(parts[p]);
+		detections.indexFrames();
+		return true;
+	}
 
-		std::ostringstream out;
-		out << std::fixed << std::setprecision(decimals) << value;
-		return out.str();
+	/// To output only up to 2 decimals: "%.2f", or "%.0f" for zero. Writes the text at
+	/// "out", which needs 64 bytes, and returns its length
+	int format_with_precision(float value, char* out)
+	{
+		if (value == 0 || !(std::fabs(value) < 1e15f))
+			return snprintf(out, 64, value == 0 ? "%.0f" : "%.2f", value);
+		// value = mantissa * 2^exponent, exactly
+		int exponent;
+		long long mantissa = (long long)std::ldexp(std::frexp(std::fabs(value), &exponent), 24);
+		exponent -= 24;
+		// Hundredths, rounded to nearest. Exact ties are left to the C library
+		unsigned long long hundredths = mantissa * 100;
+		if (exponent >= 0)
+			hundredths <<= exponent;
+		else if (exponent > -63)
+		{
+			unsigned long long rest = hundredths & ((1ULL << -exponent) - 1), half = 1ULL << (-exponent - 1);
+			if (rest == half)
+				return snprintf(out, 64, "%.2f", value);
+			hundredths = (hundredths >> -exponent) + (rest > half ? 1 : 0);
+		}
+		else
+			hundredths = 0;
+
+		char digits[24];
+		int n = 0;
+		for (unsigned long long whole = hundredths / 100; n == 0 || whole > 0; whole /= 10)
+			digits[n++] = '0' + whole % 10;
+		int length = 0;
+		if (value < 0) out[length++] = '-';
+		while (n > 0) out[length++] = digits[--n];
+		out[length++] = '.';
+		out[length++] = '0' + hundredths / 10 % 10;
+		out[length++] = '0' + hundredths % 10;
+		return length;
+	}
+
+	/// Read the results stored by write_results. Columns are the track ids, and a box
+	/// with all its values at 0 is a frame without that track
+	bool read_results(std::string& output_folder, std::string& sequence,
+		std::vector< std::vector<BoundingBox> >& track)
+	{
+		std::ifstream lx_file(output_folder + "/" + sequence + "_LX.txt");
+		std::ifstream ly_file(output_folder + "/" + sequence + "_LY.txt");
+		std::ifstream w_file(output_folder + "/" + sequence + "_W.txt");
+		std::ifstream h_file(output_folder + "/" + sequence + "_H.txt");
+		if (!lx_file || !ly_file || !w_file || !h_file) return false;
+
+		track.clear();
+		CSVIterator lx(lx_file), ly(ly_file), w(w_file), h(h_file);
+		for (; lx != CSVIterator() && ly != CSVIterator() && w != CSVIterator() && h != CSVIterator(); ++lx, ++ly, ++w, ++h)
+		{
+			std::vector<BoundingBox> frame;
+			for (int j = 0; j < (*lx).size() && j < (*ly).size() && j < (*w).size() && j < (*h).size(); j++)
+			{
+				BoundingBox b = { std::stof((*lx)[j]), std::stof((*ly)[j]), std::stof((*w)[j]), std::stof((*h)[j]), j + 1 };
+				if (b.x != 0 || b.y != 0 || b.w != 0 || b.h != 0)
+					frame.push_back(b);
+			}
+			track.push_back(frame);
+		}
+		return true;
 	}
 
-	/// Store results in UA-DETRAC format
-	void write_results(std::string& output_folder, std::string& sequence,
-		std::vector< std::vector<BoundingBox> > track)
+	/// Line of one of the result files: "field" of every box of "frame", one column per
+	/// track id. The boxes fill the columns in order of id, and a box out of order or
+	/// with a repeated id is left out
+	void append_line(std::string& block, const std::vector<BoundingBox>& frame, int amount,
+		float BoundingBox::* field)
+	{
+		char number[64];
+		int j = 0;
+		for (int id = 1; id <= amount; id++)
+		{
+			if (j < frame.size() && frame[j].id == id)
+				block.append(number, format_with_precision(frame[j++].*field, number));
+			else
+				block.push_back('0');
+			block.push_back(id < amount ? ',' : '\n');
+		}
+		if (amount == 0) block.push_back('\n');
+	}
+
+	/// Lines of one of the result files, written in large blocks
+	void write_column(std::ofstream& file, const std::vector< std::vector<BoundingBox> >& track,
+		int amount, float BoundingBox::* field)
+	{
+		const size_t blockSize = 1 << 20;
+		std::string block;
+		block.reserve(blockSize + 64);
+		for (int i = 0; i < track.size(); i++)
+		{
+			append_line(block, track[i], amount, field);
+			if (block.size() >= blockSize)
+			{
+				file.write(block.data(), block.size());
+				block.clear();
+			}
+		}
+		file.write(block.data(), block.size());
+	}
+
+	/// Store results in UA-DETRAC format. The four files are written at the same time, unless
+	/// "onPool" tells it's called from a task of a thread pool: then they're written one after
+	/// the other, without starting threads, and nothing is printed
+	void write_results(const std::string& output_folder, const std::string& sequence,
+		const std::vector< std::vector<BoundingBox> >& track, bool onPool = false)
 	{
 		char filename[255];
-		sprintf_s(filename, "%s/%s_LX.txt", output_folder.c_str(), sequence);
+		sprintf_s(filename, "%s/%s_LX.txt", output_folder.c_str(), sequence.c_str());
 		std::ofstream lx_file(filename);
-		sprintf_s(filename, "%s/%s_LY.txt", output_folder.c_str(), sequence);
+		sprintf_s(filename, "%s/%s_LY.txt", output_folder.c_str(), sequence.c_str());
 		std::ofstream ly_file(filename);
-		sprintf_s(filename, "%s/%s_W.txt", output_folder.c_str(), sequence);
+		sprintf_s(filename, "%s/%s_W.txt", output_folder.c_str(), sequence.c_str());
 		std::ofstream w_file(filename);
-		sprintf_s(filename, "%s/%s_H.txt", output_folder.c_str(), sequence);
+		sprintf_s(filename, "%s/%s_H.txt", output_folder.c_str(), sequence.c_str());
 		std::ofstream h_file(filename);
 
-		std::cout << "Creating result files" << std::endl;
-
-		int columns = track.back().size(), amount = 0;
-		std::string lx, ly, w, h, aux;
-		std::vector<BoundingBox> frame;
+		if (!onPool)
+			std::cout << "Creating result files" << std::endl;
 
 		// Get the highest id
+		int amount = 0;
 		for (int i = 0; i < track.size(); i++)
+			for (int j = 0; j < track[i].size(); j++)
+				if (amount < track[i][j].id) amount = track[i][j].id;
+
+		if (onPool)
 		{
-			frame = track[i];
-			for (int j = 0; j < frame.size(); j++)
-				if (amount < frame[j].id) amount = frame[j].id;
+			write_column(lx_file, track, amount, &BoundingBox::x);
+			write_column(ly_file, track, amount, &BoundingBox::y);
+			write_column(w_file, track, amount, &BoundingBox::w);
+			write_column(h_file, track, amount, &BoundingBox::h);
+			return;
 		}
+		std::thread lx([&]() { write_column(lx_file, track, amount, &BoundingBox::x); });
+		std::thread ly([&]() { write_column(ly_file, track, amount, &BoundingBox::y); });
+		std::thread w([&]() { write_column(w_file, track, amount, &BoundingBox::w); });
+		write_column(h_file, track, amount, &BoundingBox::h);
+		lx.join();
+		ly.join();
+		w.join();
+	}
 
-		for (int i = 0; i < track.size(); i++)
+	/// Result files written a frame at a time, while the tracker runs. The track ids
+	/// aren't all known yet, so every line has a column per id given so far: shorter
+	/// lines only leave out tracks that start later, read as 0 like the others
+	class ResultWriter
+	{
+	public:
+		/// False if a file can't be created
+		bool open(const std::string& output_folder, const std::string& sequence)
 		{
-			frame = track[i];
-			int j = 0;
+			std::string base = output_folder + "/" + sequence;
+			lx_file.open(base + "_LX.txt");
+			ly_file.open(base + "_LY.txt");
+			w_file.open(base + "_W.txt");
+			h_file.open(base + "_H.txt");
+			return lx_file && ly_file && w_file && h_file;
+		}
 
-			for (int id = 1; id <= amount; id++)
+		/// Add the line of the next frame. "boxes" sorted by id, "amount" the highest id so far
+		void write_frame(const std::vector<BoundingBox>& boxes, int amount)
+		{
+			// A line with no columns would be skipped by readers
+			amount = MAX(amount, 1);
+			std::ofstream* files[] = { &lx_file, &ly_file, &w_file, &h_file };
+			float BoundingBox::* fields[] = { &BoundingBox::x, &BoundingBox::y, &BoundingBox::w, &BoundingBox::h };
+			for (int f = 0; f < 4; f++)
 			{
-				if (frame[j].id == id && !frame.empty())
-				{
-					lx.append(to_string_with_precision(frame[j].x) + ",");
-					ly.append(to_string_with_precision(frame[j].y) + ",");
-					w.append(to_string_with_precision(frame[j].w) + ",");
-					h.append(to_string_with_precision(frame[j].h) + ",");
-					frame.erase(frame.begin()); // A nice way to unsure not trash value on frame
-				}
-				else
-				{
-					lx.append("0,");
-					ly.append("0,");
-					w.append("0,");
-					h.append("0,");
-				}
-			} // end for boxes on frame i
-			// Remove the trailing comma
-			lx.pop_back(); ly.pop_back();
-			w.pop_back(); h.pop_back();
-			// Write to files
-			lx_file << lx << std::endl;
-			ly_file << ly << std::endl;
-			w_file << w << std::endl;
-			h_file << h << std::endl;
-			// Empty the strings
-			lx.clear(); ly.clear();
-			w.clear(); h.clear();
-
+				line.clear();
+				append_line(line, boxes, amount, fields[f]);
+				// Flushed, so the results can be read while the stream goes on
+				files[f]->write(line.data(), line.size());
+				files[f]->flush();
+			}
 		}
-		// Close all the files
-		lx_file.close();
-		ly_file.close();
-		w_file.close();
-		h_file.close();
 
-	}
+	private:
+		std::ofstream lx_file, ly_file, w_file, h_file;
+		std::string line;
+	};
 
 } // end of namespace
\ No newline at end of file
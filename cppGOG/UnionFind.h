@@ -0,0 +1,50 @@
+/*
+* Disjoint sets over the items 0 to n-1
+* Used to split the detections in groups that can be tracked independently
+*/
+#pragma once
+#include <vector>
+
+class UnionFind
+{
+public:
+	UnionFind(int n = 0) { reset(n); };
+
+	void reset(int n);
+	int find(int item);
+	void unite(int a, int b);
+
+private:
+	std::vector<int> parent;
+};
+
+/******************************************************************************
+* UNION FIND IMPLEMENTATION
+******************************************************************************/
+/// Every item in its own set
+void UnionFind::reset(int n)
+{
+	parent.resize(n);
+	for (int i = 0; i < n; i++)
+		parent[i] = i;
+}
+
+/// Representative of the set of "item", which is always its smallest item
+int UnionFind::find(int item)
+{
+	while (parent[item] != item)
+	{
+		parent[item] = parent[parent[item]]; // Path halving
+		item = parent[item];
+	}
+	return item;
+}
+
+/// Join the sets of "a" and "b"
+void UnionFind::unite(int a, int b)
+{
+	a = find(a);
+	b = find(b);
+	if (a < b) parent[b] = a;
+	else if (b < a) parent[a] = b;
+}
@@ -12,6 +12,8 @@
 
 #include "CSV.h"
 #include "GOG.h"
+#include "MappedCSV.h"
+#include "ThreadPool.h"
 
 namespace YOLO
 {
@@ -41,6 +43,98 @@ namespace YOLO
 			detections.h.push_back(ymax - ymin);
 			detections.score.push_back(std::stof((*loop)[2]));
 		}
+		// Frames are read in order, so each one can be found directly
+		detections.indexFrames();
+	}
+
+	/// Frame counter of read_lines, a new frame every time the image changes
+	struct ImageCounter
+	{
+		int frame = 0;
+		// Image of the last line read
+		std::string imageName = "";
+		// Image of the first line read, to join parts of a file read on their own
+		std::string firstName = "";
+		bool empty = true;
+	};
+
+	/// Lines of a mapped file on a Detections struct, without indexing the frames
+	void read_lines(MappedCSV& file, Detections& detections, ImageCounter& counter)
+	{
+		while (file.next())
+		{
+			if (file.size() < 7 || file.equals(0, "image")) continue; // It's the header lines
+			if (counter.empty)
+			{
+				file.copy(0, counter.firstName);
+				counter.empty = false;
+			}
+			if (!file.equals(0, counter.imageName))
+			{
+				counter.frame++;
+				file.copy(0, counter.imageName);
+			}
+			detections.frame.push_back(counter.frame);
+			float xmin = file.toFloat(3);
+			float ymin = file.toFloat(4);
+			float xmax = file.toFloat(5);
+			float ymax = file.toFloat(6);
+			detections.x.push_back(xmin);
+			detections.y.push_back(ymin);
+			detections.w.push_back(xmax - xmin);
+			detections.h.push_back(ymax - ymin);
+			detections.score.push_back(file.toFloat(2));
+		}
+	}
+
+	/// Same as read_detections, reading the file in place. False if it can't be read or is empty
+	bool read_detections(const std::string& filename, Detections& detections)
+	{
+		MappedCSV file;
+		if (!file.open(filename)) return false;
+		detections.reserve(detections.x.size() + file.countLines());
+		ImageCounter counter;
+		read_lines(file, detections, counter);
+		detections.indexFrames();
+		return true;
+	}
+
+	/// Same as read_detections, every thread of "pool" reading a part of the file.
+	/// Each part counts its frames from 0, then they're moved after the frames of the
+	/// part before, continuing its frame when the part starts with the same image
+	bool read_detections(const std::string& filename, Detections& detections, ThreadPool& pool)
+	{
+		MappedCSV file;
+		if (!file.open(filename)) return false;
+		std::vector<size_t> bounds;
+		file.split(pool.size(), bounds);
+		// Parts are kept in the same store as the result
+		std::vector<Detections> parts(bounds.size() - 1, Detections(detections.x.get_allocator().store));
+		std::vector<ImageCounter> counters(parts.size());
+		pool.parallelFor(parts.size(), [&](int p)
+		{
+			MappedCSV part(file, bounds[p], bounds[p + 1]);
+			parts[p].reserve(part.countLines());
+			read_lines(part, parts[p], counters[p]);
+		});
+		size_t total = detections.x.size();
+		for (int p = 0; p < parts.size(); p++)
+			total += parts[p].x.size();
+		detections.reserve(total);
+
+		ImageCounter whole; // Same counter as reading the whole file at once
+		for (int p = 0; p < parts.size(); p++)
+		{
+			if (counters[p].empty) continue;
+			// Frame of the first line in the part, and in the whole file
+			int first = counters[p].firstName != "" ? 1 : 0;
+			int shift = whole.frame + (counters[p].firstName != whole.imageName ? 1 : 0) - first;
+			detections.append(parts[p], shift);
+			whole.frame = counters[p].frame + shift;
+			whole.imageName = counters[p].imageName;
+		}
+		detections.indexFrames();
+		return true;
 	}
 
 } // end of namespace
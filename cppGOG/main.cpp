@@ -7,6 +7,8 @@
 //#include <cstdlib>
 #include <cstdio>
 #include <string>
+#include <climits>
+#include <thread>
 
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
@@ -14,6 +16,16 @@
 #include "dirent.h"
 
 #include "GOG.h"
+#include "Batch.h"
+#include "BinaryDetections.h"
+#include "ChunkedTracking.h"
+#include "ComponentTracking.h"
+#include "DetectionStream.h"
+#include "Evaluation.h"
+#include "MinCostFlow.h"
+#include "OnlineTracking.h"
+#include "Sweep.h"
+#include "Trajectory.h"
 #include "UA-DETRAC.h"
 #include "YOLO.h"
 
@@ -35,6 +47,20 @@ int jpg_select(const struct dirent *entry)
 	return strstr(entry->d_name, ".jpg") != NULL;
 }
 
+/// Read the detections of "filename" in "type" format, "DETRAC" or "YOLO". Files written by
+/// convert are recognized by their header whatever the type
+bool load_detections(const char* filename, const char* type, Detections& dres, ThreadPool& pool)
+{
+	if (BinaryDetections::recognize(filename))
+		return BinaryDetections::read_detections(filename, dres);
+	if (0 == strcmp(type, "DETRAC"))
+		return UADETRAC::read_detections(filename, dres, pool);
+	if (0 == strcmp(type, "YOLO"))
+		return YOLO::read_detections(filename, dres, pool);
+	std::cout << "ERROR -> Unknown detections type " << type << std::endl;
+	return false;
+}
+
 /******************************************************************************
 * DEFINE SECTION
 ******************************************************************************/
@@ -42,6 +68,13 @@ int jpg_select(const struct dirent *entry)
 #define DEFAULT_OUTPUT "result"
 #define DEFAULT_DETECTIONS_TYPE "DETRAC"
 #define DEFAULT_DETECTIONS_FILE "detections.txt"
+#define DEFAULT_THREADS 1 // Threads used to build the graph. 0 means one per core
+#define DEFAULT_ENGINE "dp" // Tracking engine: "dp" (greedy, the original) or "ssp" (globally optimal)
+#define DEFAULT_OVERLAP 50 // Frames shared by consecutive chunks when tracking in chunks
+#define DEFAULT_MEMORY 1024 // MB of the out-of-core files kept in memory
+#define DEFAULT_QUEUE 64 // Frames read ahead of the tracker when streaming
+#define DEFAULT_WINDOW 100 // Frames a stream is tracked over
+#define DEFAULT_LATENCY 25 // Frames a streamed frame waits before its boxes are final
 #define SHOW_BOXES 1 // Program will output boxes after finish tracking
 #define SAVE_BOXES 0 // Save the boxes on image file
 // Turn on/off features depending if this will be embedded in UA-DETRAC toolkit or not
@@ -62,29 +95,320 @@ int main(int argc, char *argv[])
 	char* detections_file = DEFAULT_DETECTIONS_FILE; // Because of sprintf_s needs to be char* .....
 	struct dirent **filelist;
 	int fcount = -1;
+	int threads = DEFAULT_THREADS;
+	const char* engine = DEFAULT_ENGINE;
+	bool components = false; // Run the DP over every connected component on its own
+	int chunkFrames = 0; // Track in chunks of this many frames. 0 tracks the whole sequence at once
+	int overlapFrames = DEFAULT_OVERLAP;
+	char* trajectory_file = NULL; // Save every track the DP can find, to select results later
+	char* gt_file = NULL; // Ground truth to evaluate the results with
+	bool batchTracks = false; // Take the independent tracks of the DP without a pass for each one
+	int windowFrames = DEFAULT_WINDOW; // Track a stream over a window of this many frames. 0 tracks it whole at the end
+	int latencyFrames = DEFAULT_LATENCY;
+	std::vector<char*> args; // Arguments that are not options
 	clock_t begin, end;
 	// GOG necessary variables
+	char* out_of_core = NULL; // Folder of the files holding the detections and the graph
+	int memory = DEFAULT_MEMORY;
+	ColumnStore store; // Declared before the detections, which may live in it
 	Detections dres;
 	bool nms = true; // use non-maximum supression
 
 	/// Read arguments
+	// Options can go anywhere: --threads N --engine dp|ssp --components --chunk N --overlap N --save-trajectory file --gt file
+	// --out-of-core folder --memory MB --batch-tracks --window N --latency N --offline
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "--engine") && i + 1 < argc)
+			engine = argv[++i];
+		else if (0 == strcmp(argv[i], "--components"))
+			components = true;
+		else if (0 == strcmp(argv[i], "--chunk") && i + 1 < argc)
+			chunkFrames = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "--overlap") && i + 1 < argc)
+			overlapFrames = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "--save-trajectory") && i + 1 < argc)
+			trajectory_file = argv[++i];
+		else if (0 == strcmp(argv[i], "--gt") && i + 1 < argc)
+			gt_file = argv[++i];
+		else if (0 == strcmp(argv[i], "--out-of-core") && i + 1 < argc)
+			out_of_core = argv[++i];
+		else if (0 == strcmp(argv[i], "--memory") && i + 1 < argc)
+			memory = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "--batch-tracks"))
+			batchTracks = true;
+		else if (0 == strcmp(argv[i], "--window") && i + 1 < argc)
+			windowFrames = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "--latency") && i + 1 < argc)
+			latencyFrames = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "--offline"))
+			windowFrames = 0;
+		else
+			args.push_back(argv[i]);
+	}
+	if (out_of_core != NULL)
+	{
+		store.open(out_of_core, (size_t)MAX(memory, 1) << 20);
+		dres = Detections(&store);
+	}
+	// executable_name batch manifest -> every sequence of the manifest in this process
+	if (args.size() >= 2 && 0 == strcmp(args[0], "batch"))
+	{
+		std::ifstream manifest(args[1]);
+		std::vector<Batch::Job> jobs;
+		Batch::read_manifest(manifest, jobs);
+		if (jobs.empty())
+		{
+			std::cout << "ERROR -> Manifest not found or empty" << std::endl;
+			return 0;
+		}
+		ThreadPool pool(threads);
+		GOGSettings settings;
+		settings.batchExtraction = batchTracks;
+		Batch::run(jobs, pool, nms, settings);
+		return 0;
+	}
+	// executable_name convert det_file binary_file [det_type] -> detections in the binary format
+	if (args.size() >= 3 && 0 == strcmp(args[0], "convert"))
+	{
+		ThreadPool pool(threads);
+		if (!load_detections(args[1], args.size() >= 4 ? args[3] : DEFAULT_DETECTIONS_TYPE, dres, pool))
+		{
+			std::cout << "ERROR -> Detection file not found or empty" << std::endl;
+			return 0;
+		}
+		if (!BinaryDetections::write_detections(args[2], dres))
+		{
+			std::cout << "ERROR -> Failed to write " << args[2] << std::endl;
+			return 0;
+		}
+		std::cout << dres.x.size() << " detections written to " << args[2] << std::endl;
+		return 0;
+	}
+	// executable_name eval sequence gt_file result_folder -> metrics of results already written
+	if (args.size() >= 4 && 0 == strcmp(args[0], "eval"))
+	{
+		sequence = args[1];
+		output_folder = args[3];
+		std::vector< std::vector<BoundingBox> > gt, bboxes;
+		if (!Evaluation::read_ground_truth(args[2], gt) || !UADETRAC::read_results(output_folder, sequence, bboxes))
+		{
+			std::cout << "ERROR -> Ground truth or result files not found" << std::endl;
+			return 0;
+		}
+		ThreadPool pool(threads);
+		Evaluation::print_metrics(Evaluation::evaluate(gt, bboxes, &pool));
+		return 0;
+	}
+	// executable_name anytime sequence det_file trajectory_file output_folder [thr=N] [it=N]
+	// -> results of a saved trajectory, without tracking again
+	if (args.size() >= 5 && 0 == strcmp(args[0], "anytime"))
+	{
+		sequence = args[1];
+		output_folder = args[4];
+		GOGSettings settings;
+		for (int i = 5; i < args.size(); i++)
+		{
+			if (0 == strncmp(args[i], "thr=", 4))
+				settings.maxTrackCost = atoi(args[i] + 4);
+			else if (0 == strncmp(args[i], "it=", 3))
+				settings.maxIterations = atof(args[i] + 3);
+			else
+				std::cout << "ERROR -> Unknown anytime argument " << args[i] << std::endl;
+		}
+		Trajectory trajectory;
+		ThreadPool pool(threads);
+		if (!load_detections(args[2], DEFAULT_DETECTIONS_TYPE, dres, pool) || !trajectory.load(args[3]))
+		{
+			std::cout << "ERROR -> Detection or trajectory file not found or empty" << std::endl;
+			return 0;
+		}
+		if (!trajectory.covers(settings.maxTrackCost, settings.maxIterations))
+			std::cout << "\tWARNING -> The trajectory stops before these settings, the result is incomplete" << std::endl;
+		std::vector<int> indices, ids;
+		trajectory.select(settings.maxTrackCost, settings.maxIterations, indices, ids);
+		std::cout << "Result size > " << indices.size() << std::endl;
+		std::vector< std::vector<BoundingBox> > bboxes = tracksToBoxes(dres, indices, ids);
+		DIR * dir = opendir(output_folder.c_str());
+		if (dir != NULL)
+			closedir(dir);
+		else if (system(("mkdir " + output_folder).c_str()))
+		{
+			std::cout << "\tERROR -> Failed to create directory" << std::endl;
+			return 0;
+		}
+		if (!bboxes.empty())
+			UADETRAC::write_results(output_folder, sequence, bboxes);
+		return 0;
+	}
+	// executable_name sweep sequence det_file output_folder name=values... -> one result per settings
+	if (args.size() >= 4 && 0 == strcmp(args[0], "sweep"))
+	{
+		sequence = args[1];
+		output_folder = args[3];
+		Sweep::Grid grid;
+		for (int i = 4; i < args.size(); i++)
+			if (!Sweep::read_argument(args[i], grid))
+				std::cout << "ERROR -> Unknown sweep argument " << args[i] << std::endl;
+		ThreadPool pool(threads);
+		if (!load_detections(args[2], DEFAULT_DETECTIONS_TYPE, dres, pool))
+		{
+			std::cout << "ERROR -> Detection file not found or empty" << std::endl;
+			return 0;
+		}
+		DIR * dir = opendir(output_folder.c_str());
+		if (dir != NULL)
+			closedir(dir);
+		else if (system(("mkdir " + output_folder).c_str()))
+		{
+			std::cout << "\tERROR -> Failed to create directory" << std::endl;
+			return 0;
+		}
+
+		std::vector<GOGSettings> all = Sweep::combinations(grid);
+		for (int i = 0; i < all.size(); i++)
+			all[i].batchExtraction = batchTracks;
+		std::cout << "Sweeping " << all.size() << " settings" << std::endl;
+		begin = clock();
+		TrackingGraph graph(dres, &pool);
+		Sweep::run(graph, all, nms, pool, output_folder, sequence);
+		end = clock();
+		std::cout << "Time spent sweeping : " << (double)(end - begin) / CLOCKS_PER_SEC << "seconds" << std::endl;
+		return 0;
+	}
+	// executable_name stream sequence det_file|- output_folder [det_type] -> detections tracked while
+	// they are written, from a named pipe or the standard input ("-")
+	if (args.size() >= 4 && 0 == strcmp(args[0], "stream"))
+	{
+		sequence = args[1];
+		output_folder = args[3];
+		const char* type = args.size() >= 5 ? args[4] : DEFAULT_DETECTIONS_TYPE;
+		std::ifstream pipe;
+		std::istream* input = &std::cin;
+		if (0 != strcmp(args[2], "-"))
+		{
+			pipe.open(args[2]);
+			input = &pipe;
+		}
+		else
+			std::ios::sync_with_stdio(false);
+		if (!*input)
+		{
+			std::cout << "ERROR -> Detection stream not found" << std::endl;
+			return 0;
+		}
+		DIR * dir = opendir(output_folder.c_str());
+		if (dir != NULL)
+			closedir(dir);
+		else if (system(("mkdir " + output_folder).c_str()))
+		{
+			std::cout << "\tERROR -> Failed to create directory" << std::endl;
+			return 0;
+		}
+		UADETRAC::ResultWriter writer;
+		if (windowFrames > 0 && !writer.open(output_folder, sequence))
+		{
+			std::cout << "ERROR -> Failed to create the result files" << std::endl;
+			return 0;
+		}
+
+		begin = clock();
+		FrameQueue<DetectionStream::Frame> queue(DEFAULT_QUEUE);
+		std::thread reader([&]() { DetectionStream::read_frames(*input, type, queue); });
+		DetectionStream::Frame item;
+		int frames = 0;
+		GOGSettings settings;
+		settings.batchExtraction = batchTracks;
+		if (windowFrames > 0)
+		{
+			// Every frame is tracked with the ones around it as it arrives, and written
+			// once it's final. Only the window is kept in memory
+			OnlineTracking online(nms, windowFrames, latencyFrames, settings);
+			std::vector<BoundingBox> boxes, previous;
+			int pushed = 0, highest = 0, finalized = 0;
+			long long kept = 0;
+			// Frames are written one behind, so the last one is left out like in the
+			// offline results. Line 0 is frame 0, which has no detections
+			auto emit = [&]()
+			{
+				for (int b = 0; b < boxes.size(); b++)
+					highest = MAX(highest, boxes[b].id);
+				kept += previous.size();
+				writer.write_frame(previous, highest);
+				previous.swap(boxes);
+				finalized++;
+			};
+			Detections empty;
+			while (queue.pop(item))
+			{
+				if (item.number <= pushed)
+				{
+					std::cout << "ERROR -> Frame " << item.number << " read after frame " << pushed << ", skipped" << std::endl;
+					continue;
+				}
+				// Frames the detector skipped are pushed empty, so every line is its frame
+				while (pushed < item.number)
+				{
+					pushed++;
+					if (online.pushFrame(pushed == item.number ? item.detections : empty, boxes))
+						emit();
+				}
+				frames++;
+			}
+			while (online.flush(boxes))
+				emit();
+			end = clock();
+			if (frames == 0)
+				std::cout << "ERROR -> Detection stream empty" << std::endl;
+			std::cout << "Frames read : " << frames << std::endl;
+			std::cout << "Result size > " << kept << std::endl;
+		}
+		else
+		{
+			// The graph grows frame by frame while the next ones are read, and the DP
+			// runs at the end, with the same tracks as reading the whole file first
+			TrackingGraph graph;
+			while (queue.pop(item))
+			{
+				graph.appendFrame(item.detections, item.number);
+				frames++;
+			}
+			if (frames == 0)
+			{
+				reader.join();
+				std::cout << "ERROR -> Detection stream empty" << std::endl;
+				return 0;
+			}
+			std::cout << "Frames read : " << frames << std::endl;
+			DPTracking gog(nms, graph, settings);
+			gog.startTracking();
+			end = clock();
+			std::cout << "Result size > " << gog.getIndices().size() << std::endl;
+			UADETRAC::write_results(output_folder, sequence, gog.getBBoxes());
+		}
+		reader.join();
+		std::cout << "Time spent tracking : " << (double)(end - begin) / CLOCKS_PER_SEC << "seconds" << std::endl;
+		return 0;
+	}
 	// TODO: CONTROL OVER THIS OPTIONS, ESPECIALLY DETECTIONS ONE
 #if USE_IN_DETRAC
 	// executable_name sequence input_folder
-	if (argc >= 2)
+	if (args.size() >= 2)
 	{
-		sequence = argv[1];
-		input_folder = argv[2];
+		sequence = args[0];
+		input_folder = args[1];
 	}
 #else 
 	// executable_name sequence input_folder det_type det_file output_folder
-	if (argc >= 6)
+	if (args.size() >= 5)
 	{
-		sequence = argv[1];
-		input_folder = argv[2];
-		detections_type = argv[3];
-		detections_file = argv[4];
-		output_folder = argv[5];
+		sequence = args[0];
+		input_folder = args[1];
+		detections_type = args[2];
+		detections_file = args[3];
+		output_folder = args[4];
 	}
 #endif
 
@@ -92,29 +416,17 @@ int main(int argc, char *argv[])
 	std::cout << "input folder: " << input_folder << std::endl;
 
 	/// Loading detections part
-	// First verify that the detections file exists
-	std::ifstream detStream(detections_file);
-	if (!detStream || detStream.eof())
+	// The file is mapped and parsed in place. Reading fails if it doesn't exist or is empty
+	// Parts of the file are read on the threads also used to build the graph
+	ThreadPool pool(threads);
+	std::cout << "Loading detections..." << std::endl;
+	// Load all detections before starting tracking. Inside UA-DETRAC the type is always DETRAC
+	if (!load_detections(detections_file, detections_type, dres, pool))
 	{
 		std::cout << "ERROR -> Detection file not found or empty" << std::endl;
 		cv::waitKey(0);
 		return 0;
 	}
-	else
-	{
-		std::cout << "Detection file found. Loading detections..." << std::endl;
-		// Load all detections before starting tracking.
-#if USE_IN_DETRAC
-		UADETRAC::read_detections(detStream, dres);
-#else
-		if (0 == strcmp(detections_type, "DETRAC")) {
-			UADETRAC::read_detections(detStream, dres);
-		}
-		else if (0 == strcmp(detections_type, "YOLO")) {
-			YOLO::read_detections(detStream, dres);
-		}
-#endif
-	}
 
 	//std::cout << "Amount of lines read -> " << dres.x.size() << std::endl;
 	//std::cout << "Amount of images -> " << dres.frame.back() << std::endl;
@@ -150,20 +462,93 @@ int main(int argc, char *argv[])
 
 	/// Create the graph based on the detections
 	begin = clock(); // Start timer
-	TrackingGraph graph = TrackingGraph(dres);
 
 	/// Create an instance of GOG and start the tracking
+	/// Variable that holds the boxes to draw/write info in file
+	std::vector< std::vector<BoundingBox> > bboxes;
 	GOGSettings settings;
-	DPTracking gog = DPTracking(nms, graph, settings);
-	gog.startTracking();
-	end = clock(); // End timer
+	settings.batchExtraction = batchTracks;
+	if (chunkFrames > 0)
+	{
+		// Every chunk builds its own graph, so the one of the whole sequence is never built
+		ChunkedTracking gog(nms, dres, chunkFrames, overlapFrames, &pool, settings);
+		gog.startTracking();
+		end = clock(); // End timer
+		std::cout << "Result size > " << gog.getIndices().size() << std::endl;
+		std::cout << "Chunks : " << gog.getChunkCount() << std::endl;
+		bboxes = gog.getBBoxes();
+	}
+	else
+	{
+		TrackingGraph graph(dres, &pool); // Only keeps a reference to "dres"
+		if (0 == strcmp(engine, "ssp"))
+		{
+			// Globally optimal tracks. NMS is not used by this engine
+			SSPTracking ssp(graph, settings);
+			ssp.startTracking();
+			end = clock(); // End timer
+			std::cout << "Result size > " << ssp.getIndices().size() << std::endl;
+			bboxes = ssp.getBBoxes();
+		}
+		else if (components)
+		{
+			// Same tracks as the DP, with the components tracked on the pool
+			ComponentTracking gog(nms, graph, &pool, settings);
+			gog.startTracking();
+			end = clock(); // End timer
+			std::cout << "Result size > " << gog.getIndices().size() << std::endl;
+			std::cout << "Connected components : " << gog.getComponentCount() << std::endl;
+			bboxes = gog.getBBoxes();
+		}
+		else
+		{
+			if (0 != strcmp(engine, "dp"))
+				std::cout << "ERROR -> Unknown engine " << engine << ", using dp" << std::endl;
+			// To save the trajectory, the DP runs until there's nothing left to track,
+			// and the result of the settings is taken from it
+			GOGSettings runSettings = settings;
+			if (trajectory_file != NULL)
+			{
+				runSettings.maxTrackCost = INT_MAX;
+				runSettings.maxIterations = INFINITY;
+			}
+			DPTracking gog(nms, graph, runSettings);
+			gog.startTracking();
+			end = clock(); // End timer
+#ifdef _DEBUG
+			std::cout << "Allocations in the tracking loop : " << gog.getLoopAllocations() << std::endl;
+#endif
+			std::cout << "Passes : " << gog.getPasses() << std::endl;
+			if (trajectory_file != NULL)
+			{
+				Trajectory trajectory(gog, runSettings);
+				if (!trajectory.save(trajectory_file))
+					std::cout << "ERROR -> Failed to save the trajectory" << std::endl;
+				std::vector<int> indices, ids;
+				trajectory.select(settings.maxTrackCost, settings.maxIterations, indices, ids);
+				std::cout << "Result size > " << indices.size() << std::endl;
+				bboxes = tracksToBoxes(graph.getDres(), indices, ids);
+			}
+			else
+			{
+				std::cout << "Result size > " << gog.getIndices().size() << std::endl;
+				/// Get the detections and their ids after tracking
+				bboxes = gog.getBBoxes();
+			}
+		}
+	}
 	// Print time spent tracking
 	double time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
 	std::cout << "Time spent tracking : " << time_spent << "seconds" << std::endl;
 
-	/// Get the detections and their ids after tracking 
-	/// Variable that holds the boxes to draw/write info in file
-	std::vector< std::vector<BoundingBox> > bboxes = gog.getBBoxes();
+	if (gt_file != NULL)
+	{
+		std::vector< std::vector<BoundingBox> > gt;
+		if (!Evaluation::read_ground_truth(gt_file, gt))
+			std::cout << "ERROR -> Ground truth file not found or empty" << std::endl;
+		else
+			Evaluation::print_metrics(Evaluation::evaluate(gt, bboxes, &pool));
+	}
 
 #if !USE_IN_DETRAC
 #if SHOW_BOXES